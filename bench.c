@@ -0,0 +1,559 @@
+/*
+ * Scan Bluetooth's for Info
+ * Copyright (C) 2025 Hermawan <minghermawan@yahoo.com>
+ * https://www.linkedin.com/in/hermawan-ho-a3801194/
+ * GNU General Public License (GPL) v3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sqlite3.h>
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/hci.h>
+#include "btinfo.h"
+#include "btcache.h"
+#include "btcompany.h"
+#include "btoui.h"
+#include "dbsqlite.h"
+
+const int LOOKUP_NUM = 1000000;
+// Row-at-a-time database modes take about a millisecond per row, so they
+// only run for sizes up to this.
+const int SLOW_DB_MAX = 1000;
+const int MAX_SIZES = 16;
+const char *BENCH_DB = "bench.db";
+const char *BENCH_OUI = "bench-oui.txt";
+const char *BENCH_COMPANIES = "company_ids.yaml";
+const char *BENCH_ALL = "index,db,load,oui,company,type,addr";
+
+static bool isJson = false;
+
+static double nowSec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Every result is one line: "<bench> key=value ..." or, with -f json, a
+// JSON object with the same keys, so runs can be diffed across versions.
+static void beginResult(const char *bench) {
+    if (isJson)
+        printf("{\"bench\":\"%s\"", bench);
+    else
+        printf("%s", bench);
+}
+
+static void addStr(const char *key, const char *val) {
+    if (isJson)
+        printf(",\"%s\":\"%s\"", key, val);
+    else
+        printf(" %s=%s", key, val);
+}
+
+static void addInt(const char *key, long val) {
+    if (isJson)
+        printf(",\"%s\":%ld", key, val);
+    else
+        printf(" %s=%ld", key, val);
+}
+
+static void addNum(const char *key, double val) {
+    if (isJson)
+        printf(",\"%s\":%.1f", key, val);
+    else
+        printf(" %s=%.1f", key, val);
+}
+
+static void endResult() {
+    printf(isJson ? "}\n" : "\n");
+    fflush(stdout);
+}
+
+static uint64_t nextRand(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static void randAddrs(bdaddr_t *out, int num, uint64_t seed) {
+    uint64_t state = seed;
+    for (int n1 = 0; n1 < num; n1++) {
+        uint64_t val = nextRand(&state);
+        for (int n2 = 0; n2 < 6; n2++)
+            out[n1].b[n2] = (uint8_t)(val >> (n2 * 8));
+    }
+}
+
+static void fmtAddr(const bdaddr_t *btAddr, char out[19]) {
+    sprintf(
+      out,
+      "%2.2X:%2.2X:%2.2X:%2.2X:%2.2X:%2.2X",
+      btAddr->b[5], btAddr->b[4], btAddr->b[3],
+      btAddr->b[2], btAddr->b[1], btAddr->b[0]);
+}
+
+// The getBTIdx() scan this index replaced, kept for comparison.
+static int linearFind(char addr[19], char (*addrs)[19], int count) {
+    for (int n = 0; n < count; n++) {
+        if (strcmp(addrs[n], addr) == 0)
+            return n;
+    }
+    return -1;
+}
+
+static void benchIndex(int num) {
+    bdaddr_t *addrs = malloc(num * sizeof(bdaddr_t));
+    bdaddr_t *misses = malloc(num * sizeof(bdaddr_t));
+    randAddrs(addrs, num, 0x2545F4914F6CDD1DULL);
+    randAddrs(misses, num, 0x9E3779B97F4A7C15ULL);
+
+    struct BTIndex btIndex;
+    IndexInit(&btIndex, 0);
+    double start = nowSec();
+    for (int n = 0; n < num; n++)
+        IndexPut(&btIndex, &addrs[n], n);
+    double putSec = nowSec() - start;
+
+    long sum = 0;
+    start = nowSec();
+    for (int n = 0; n < LOOKUP_NUM; n++)
+        sum += IndexFind(&btIndex, &addrs[n % num]);
+    double hitSec = nowSec() - start;
+    start = nowSec();
+    for (int n = 0; n < LOOKUP_NUM; n++)
+        sum += IndexFind(&btIndex, &misses[n % num]);
+    double missSec = nowSec() - start;
+
+    beginResult("index");
+    addInt("n", num);
+    addNum("put_ns", putSec * 1e9 / num);
+    addNum("hit_ns", hitSec * 1e9 / LOOKUP_NUM);
+    addNum("miss_ns", missSec * 1e9 / LOOKUP_NUM);
+    addInt("check", sum);
+    endResult();
+    IndexFree(&btIndex);
+
+    // The linear scan is O(n) per lookup, so sample fewer lookups.
+    char (*strAddrs)[19] = malloc(num * sizeof(*strAddrs));
+    for (int n = 0; n < num; n++)
+        fmtAddr(&addrs[n], strAddrs[n]);
+    int linearNum = num > 100000 ? 100 : 100000000 / num;
+    char addr[19];
+    start = nowSec();
+    for (int n = 0; n < linearNum; n++) {
+        fmtAddr(&addrs[(n * 7919) % num], addr);
+        sum += linearFind(addr, strAddrs, num);
+    }
+    double linearSec = nowSec() - start;
+    beginResult("linear");
+    addInt("n", num);
+    addNum("hit_ns", linearSec * 1e9 / linearNum);
+    addInt("check", sum);
+    endResult();
+
+    free(strAddrs);
+    free(addrs);
+    free(misses);
+}
+
+// With isReopen the database is closed after every call, which is how
+// dbsqlite.c worked before it kept one connection open. batchRows = 1
+// commits every write on its own, as autocommit did.
+static void benchDB(int num, bool isReopen, int batchRows) {
+    unlink(BENCH_DB);
+    OpenDB(BENCH_DB);
+    SetBatchLimits(batchRows, 0);
+    CreateTblLookups();
+    CreateTblBT();
+    bdaddr_t *addrs = malloc(num * sizeof(bdaddr_t));
+    randAddrs(addrs, num, 0x2545F4914F6CDD1DULL);
+
+    struct BTStruct bt;
+    memset(&bt, 0, sizeof(bt));
+    bt.txPower = TX_POWER_UNKNOWN;
+    bt.cod = 0x5A020C;
+    bt.companyId = 15;
+    strcpy(bt.name, "Bench Device");
+    bt.lmpVer = 9;
+    bt.lmpSubVer = 1234;
+    double start = nowSec();
+    for (int n = 0; n < num; n++) {
+        fmtAddr(&addrs[n], bt.addr);
+        UpsertBT(&bt);
+        if (isReopen) {
+            CloseDB();
+            OpenDB(BENCH_DB);
+            SetBatchLimits(batchRows, 0);
+        }
+    }
+    CommitBatch();
+    double insSec = nowSec() - start;
+
+    struct BTStruct upd;
+    memset(&upd, 0, sizeof(upd));
+    upd.txPower = TX_POWER_UNKNOWN;
+    upd.cod = -1;
+    upd.companyId = -1;
+    strcpy(upd.name, "Renamed Device");
+    upd.lmpVer = 10;
+    start = nowSec();
+    for (int n = 0; n < num; n++) {
+        fmtAddr(&addrs[n], upd.addr);
+        UpsertBT(&upd);
+        if (isReopen) {
+            CloseDB();
+            OpenDB(BENCH_DB);
+            SetBatchLimits(batchRows, 0);
+        }
+    }
+    CommitBatch();
+    double updSec = nowSec() - start;
+
+    beginResult("db");
+    addInt("n", num);
+    addInt("reopen", isReopen);
+    addInt("batch", batchRows);
+    addNum("ins_per_sec", num / insSec);
+    addNum("upd_per_sec", num / updSec);
+    endResult();
+    CloseDB();
+    unlink(BENCH_DB);
+    free(addrs);
+}
+
+// A registry in the IEEE oui.txt layout with num random assignments,
+// about the size of the real one at 40000.
+static void benchOUI(int num) {
+    FILE *file = fopen(BENCH_OUI, "w");
+    if (!file) {
+        perror("Can't create OUI file");
+        exit(1);
+    }
+    uint32_t *ouis = malloc(num * sizeof(uint32_t));
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    for (int n = 0; n < num; n++) {
+        ouis[n] = nextRand(&state) & 0xFFFFFF;
+        fprintf(
+          file,
+          "%2.2X-%2.2X-%2.2X   (hex)\t\tVendor %d\r\n"
+          "%6.6X     (base 16)\t\tVendor %d\r\n"
+          "\t\t\t\tSome Street\r\n\r\n",
+          ouis[n] >> 16, (ouis[n] >> 8) & 0xFF, ouis[n] & 0xFF, n,
+          ouis[n], n);
+    }
+    fclose(file);
+
+    double start = nowSec();
+    OpenOUI(BENCH_OUI);
+    double loadSec = nowSec() - start;
+
+    int len;
+    int found = 0;
+    start = nowSec();
+    for (int n = 0; n < LOOKUP_NUM; n++)
+        found += FindOUI(ouis[n % num], &len) != NULL;
+    double hitSec = nowSec() - start;
+
+    beginResult("oui");
+    addInt("n", num);
+    addInt("found", found);
+    addNum("load_ms", loadSec * 1e3);
+    addNum("hit_ns", hitSec * 1e9 / LOOKUP_NUM);
+    endResult();
+    CloseOUI();
+    unlink(BENCH_OUI);
+    free(ouis);
+}
+
+// Strip the quotes gencompanyids.py strips from a yaml name in place.
+static void unquoteName(char *val) {
+    size_t len = strcspn(val, "\r\n");
+    while (len && (val[len - 1] == ' '))
+        len -= 1;
+    val[len] = '\0';
+    if ((len < 2) || ((val[0] != '\'') && (val[0] != '"')))
+        return;
+    char quote = val[0];
+    if (val[len - 1] != quote)
+        return;
+    char *out = val;
+    for (char *c = val + 1; c < val + len - 1; c++) {
+        if ((quote == '\'') && (c[0] == '\'') && (c[1] == '\''))
+            c += 1;
+        else if ((quote == '"') && (c[0] == '\\') && c[1])
+            c += 1;
+        *out++ = *c;
+    }
+    *out = '\0';
+}
+
+// Read the names of the company list btcompany.c is generated from.
+static char **readCompanies() {
+    FILE *file = fopen(BENCH_COMPANIES, "r");
+    if (!file) {
+        perror("Can't open company list");
+        exit(1);
+    }
+    char **names = calloc(0x10000, sizeof(char *));
+    char line[512];
+    long id = -1;
+    while (fgets(line, sizeof(line), file)) {
+        char *val = line + strspn(line, " -");
+        if (strncmp(val, "value:", 6) == 0) {
+            id = strtol(val + 6, NULL, 0);
+        } else if ((strncmp(val, "name:", 5) == 0) && (id >= 0)) {
+            val += 5 + strspn(val + 5, " ");
+            unquoteName(val);
+            if (id <= 0xFFFF) {
+                free(names[id]);
+                names[id] = strdup(val);
+            }
+            id = -1;
+        }
+    }
+    fclose(file);
+    return names;
+}
+
+// Check every 16-bit id once against the company list, then time lookups
+// of random ids.
+static void benchCompany() {
+    struct BTStruct bt;
+    char **names = readCompanies();
+    int assigned = 0;
+    for (int id = 0; id <= 0xFFFF; id++) {
+        const char *name = getManufactureName(id);
+        const char *want = names[id] ? names[id] : "not assigned";
+        if (id == 0xFFFF)
+            want = "internal use";
+        if(
+          !name
+          || (strlen(name) >= sizeof(bt.manufactureName))
+          || (strcmp(name, want) != 0)
+        ) {
+            printf(
+              "company id=0x%04X name=\"%s\" want \"%s\"\n",
+              id,
+              name ? name : "(null)",
+              want);
+            exit(1);
+        }
+        if (strcmp(name, "not assigned") != 0)
+            assigned += 1;
+        free(names[id]);
+    }
+    free(names);
+
+    uint64_t state = 0x2545F4914F6CDD1DULL;
+    int hits = 0;
+    double start = nowSec();
+    for (int n = 0; n < LOOKUP_NUM; n++)
+        hits += getManufactureName(nextRand(&state) & 0xFFFF)[0] != 'n';
+    double lookupSec = nowSec() - start;
+
+    beginResult("company");
+    addInt("assigned", assigned);
+    addInt("hits", hits);
+    addNum("lookup_ns", lookupSec * 1e9 / LOOKUP_NUM);
+    endResult();
+}
+
+// Decode random Classes of Device; the first call builds the table.
+static void benchType() {
+    uint8_t devClass[3] = {0x0C, 0x02, 0x5A};
+    double start = nowSec();
+    getTypeId(devClass);
+    double buildSec = nowSec() - start;
+
+    uint64_t state = 0x2545F4914F6CDD1DULL;
+    long len = 0;
+    start = nowSec();
+    for (int n = 0; n < LOOKUP_NUM; n++) {
+        uint64_t val = nextRand(&state);
+        devClass[0] = val;
+        devClass[1] = val >> 8;
+        devClass[2] = val >> 16;
+        len += strlen(getTypeName(getTypeId(devClass)));
+    }
+    double lookupSec = nowSec() - start;
+
+    beginResult("type");
+    addNum("build_us", buildSec * 1e6);
+    addNum("lookup_ns", lookupSec * 1e9 / LOOKUP_NUM);
+    addInt("check", len);
+    endResult();
+}
+
+static void benchAddr() {
+    bdaddr_t *addrs = malloc(LOOKUP_NUM * sizeof(bdaddr_t));
+    randAddrs(addrs, LOOKUP_NUM, 0x2545F4914F6CDD1DULL);
+    char addr[19];
+    long sum = 0;
+    double start = nowSec();
+    for (int n = 0; n < LOOKUP_NUM; n++) {
+        ba2str(&addrs[n], addr);
+        sum += addr[16];
+    }
+    double fmtSec = nowSec() - start;
+    bdaddr_t btAddr;
+    start = nowSec();
+    for (int n = 0; n < LOOKUP_NUM; n++) {
+        addr[15] = "0123456789ABCDEF"[n & 15];
+        str2ba(addr, &btAddr);
+        sum += btAddr.b[0];
+    }
+    double parseSec = nowSec() - start;
+
+    beginResult("addr");
+    addNum("ba2str_ns", fmtSec * 1e9 / LOOKUP_NUM);
+    addNum("str2ba_ns", parseSec * 1e9 / LOOKUP_NUM);
+    addInt("check", sum);
+    endResult();
+    free(addrs);
+}
+
+static void onLoadRow(struct BTStruct *bt, void *arg) {
+    struct BTCache *cache = arg;
+    bdaddr_t btAddr;
+    str2ba(bt->addr, &btAddr);
+    int btIdx = CacheFind(cache, &btAddr);
+    if (btIdx < 0)
+        btIdx = CacheAdd(cache, &btAddr);
+    struct BTRecord *rec = &cache->recs[btIdx];
+    rec->nameOff = ArenaIntern(&cache->names, bt->name);
+    rec->typeId = SymIntern(&cache->syms, bt->type);
+    rec->manufactureId = SymIntern(&cache->syms, bt->manufactureName);
+}
+
+// Startup load of num stored devices into the cache, on the main
+// connection and on the private read-only one the -l loader uses.
+static void benchLoad(int num) {
+    unlink(BENCH_DB);
+    OpenDB(BENCH_DB);
+    SetBatchLimits(0, 0);
+    CreateTblLookups();
+    CreateTblBT();
+    bdaddr_t *addrs = malloc(num * sizeof(bdaddr_t));
+    randAddrs(addrs, num, 0x2545F4914F6CDD1DULL);
+    struct BTStruct bt;
+    memset(&bt, 0, sizeof(bt));
+    bt.txPower = TX_POWER_UNKNOWN;
+    bt.cod = 0x5A020C;
+    bt.companyId = 15;
+    bt.lmpVer = 9;
+    // Keyed the way the bt view joins them, so the load resolves both.
+    SetLookupName(LOOKUP_TYPE, (bt.cod >> 2) & 2047, "Smart phone");
+    SetLookupName(LOOKUP_MANUFACTURER, bt.companyId, "Broadcom Corporation");
+    for (int n = 0; n < num; n++) {
+        fmtAddr(&addrs[n], bt.addr);
+        snprintf(bt.name, sizeof(bt.name), "Bench Device %d", n);
+        UpsertBT(&bt);
+    }
+    CommitBatch();
+
+    struct BTCache cache;
+    CacheInit(&cache, 0);
+    double start = nowSec();
+    GetBTs(NULL, onLoadRow, &cache);
+    double mainSec = nowSec() - start;
+    CacheFree(&cache);
+    CacheInit(&cache, 0);
+    start = nowSec();
+    GetBTs(BENCH_DB, onLoadRow, &cache);
+    double privateSec = nowSec() - start;
+
+    beginResult("load");
+    addInt("n", num);
+    addInt("loaded", cache.count);
+    addNum("main_rows_per_sec", num / mainSec);
+    addNum("private_rows_per_sec", num / privateSec);
+    endResult();
+    CacheFree(&cache);
+    CloseDB();
+    unlink(BENCH_DB);
+    free(addrs);
+}
+
+static bool isSelected(const char *benches, const char *name) {
+    size_t len = strlen(name);
+    for (const char *pos = benches; (pos = strstr(pos, name)); pos++) {
+        if(
+          ((pos == benches) || (pos[-1] == ','))
+          && ((pos[len] == ',') || (pos[len] == '\0'))
+        )
+            return true;
+    }
+    return false;
+}
+
+int main(int argc, char *argv[]) {
+    int sizes[MAX_SIZES];
+    int sizeCnt = 0;
+    const char *sizeList = "1000,100000,1000000";
+    const char *benches = BENCH_ALL;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:b:f:")) != -1) {
+        switch (opt) {
+          case 'n':
+            sizeList = optarg;
+            break;
+          case 'b':
+            benches = optarg;
+            break;
+          case 'f':
+            isJson = strcmp(optarg, "json") == 0;
+            if (isJson || (strcmp(optarg, "text") == 0))
+                break;
+            // fall through
+          default:
+            printf(
+              "Usage: %s [-n size,...] [-b bench,...] [-f text|json]\n"
+              "Benches: %s\n",
+              argv[0],
+              BENCH_ALL);
+            exit(1);
+        }
+    }
+    for(
+      const char *pos = sizeList;
+      *pos && (sizeCnt < MAX_SIZES);
+      pos += strcspn(pos, ",") + (pos[strcspn(pos, ",")] == ',')
+    ) {
+        sizes[sizeCnt] = atoi(pos);
+        if (sizes[sizeCnt] > 0)
+            sizeCnt += 1;
+    }
+
+    beginResult("run");
+    addStr("sqlite", sqlite3_libversion());
+    addStr("compiler", __VERSION__);
+    addInt("lookups", LOOKUP_NUM);
+    addInt("time", time(NULL));
+    endResult();
+    for (int n = 0; n < sizeCnt; n++) {
+        if (isSelected(benches, "index"))
+            benchIndex(sizes[n]);
+        if (isSelected(benches, "db") && (sizes[n] <= SLOW_DB_MAX)) {
+            benchDB(sizes[n], true, 1);
+            benchDB(sizes[n], false, 1);
+        }
+        if (isSelected(benches, "db"))
+            benchDB(sizes[n], false, 0);
+        if (isSelected(benches, "load"))
+            benchLoad(sizes[n]);
+    }
+    if (isSelected(benches, "oui"))
+        benchOUI(40000);
+    if (isSelected(benches, "company"))
+        benchCompany();
+    if (isSelected(benches, "type"))
+        benchType();
+    if (isSelected(benches, "addr"))
+        benchAddr();
+    return 0;
+}
@@ -0,0 +1,314 @@
+/*
+ * Scan Bluetooth's for Info
+ * Copyright (C) 2025 Hermawan <minghermawan@yahoo.com>
+ * https://www.linkedin.com/in/hermawan-ho-a3801194/
+ * GNU General Public License (GPL) v3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/hci.h>
+#include "btinfo.h"
+#include "btcache.h"
+
+// Bit 48 marks a used slot so 00:00:00:00:00:00 is still a valid key.
+const uint64_t SLOT_USED = 1ULL << 48;
+// A deleted slot keeps probe chains through it intact until the next
+// rehash.
+const uint64_t SLOT_DELETED = 1;
+
+// The address as a number, most significant byte first as it is written.
+uint64_t PackAddr(const bdaddr_t *btAddr) {
+    uint64_t out = 0;
+    for (int n = 0; n < 6; n++)
+        out |= (uint64_t)btAddr->b[n] << (n * 8);
+    return out;
+}
+
+static uint32_t hashKey(uint64_t key, uint32_t mask) {
+    return (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+}
+
+static void allocSlots(struct BTIndex *index, uint32_t size) {
+    index->slots = calloc(size, sizeof(struct BTSlot));
+    if (!index->slots) {
+        perror("Can't allocate memory");
+        exit(1);
+    }
+    index->mask = size - 1;
+}
+
+// Rebuild without deleted slots, twice the size when at least half of
+// the slots are still in use.
+static void growIndex(struct BTIndex *index) {
+    struct BTSlot *oldSlots = index->slots;
+    uint32_t oldSize = index->mask + 1;
+    allocSlots(index, index->cnt >= oldSize / 2 ? oldSize * 2 : oldSize);
+    index->deadCnt = 0;
+    for (uint32_t n = 0; n < oldSize; n++) {
+        if (!(oldSlots[n].key & SLOT_USED))
+            continue;
+        uint32_t pos = hashKey(oldSlots[n].key, index->mask);
+        while (index->slots[pos].key)
+            pos = (pos + 1) & index->mask;
+        index->slots[pos] = oldSlots[n];
+    }
+    free(oldSlots);
+}
+
+void IndexInit(struct BTIndex *index, uint32_t cap) {
+    uint32_t size = 64;
+    while (size / 4 * 3 < cap)
+        size *= 2;
+    allocSlots(index, size);
+    index->cnt = 0;
+    index->deadCnt = 0;
+}
+
+// Return the record index stored for btAddr, or -1 when unknown.
+int IndexFind(struct BTIndex *index, const bdaddr_t *btAddr) {
+    uint64_t key = PackAddr(btAddr) | SLOT_USED;
+    uint32_t pos = hashKey(key, index->mask);
+    while (index->slots[pos].key) {
+        if (index->slots[pos].key == key)
+            return index->slots[pos].idx;
+        pos = (pos + 1) & index->mask;
+    }
+    return -1;
+}
+
+void IndexPut(struct BTIndex *index, const bdaddr_t *btAddr, uint32_t idx) {
+    if (index->cnt + index->deadCnt + 1 > (index->mask + 1) / 4 * 3)
+        growIndex(index);
+    uint64_t key = PackAddr(btAddr) | SLOT_USED;
+    uint32_t pos = hashKey(key, index->mask);
+    int64_t deadPos = -1;
+    while (index->slots[pos].key) {
+        if (index->slots[pos].key == key) {
+            index->slots[pos].idx = idx;
+            return;
+        }
+        if ((index->slots[pos].key == SLOT_DELETED) && (deadPos < 0))
+            deadPos = pos;
+        pos = (pos + 1) & index->mask;
+    }
+    if (deadPos >= 0) {
+        pos = deadPos;
+        index->deadCnt -= 1;
+    }
+    index->slots[pos].key = key;
+    index->slots[pos].idx = idx;
+    index->cnt += 1;
+}
+
+void IndexDelete(struct BTIndex *index, const bdaddr_t *btAddr) {
+    uint64_t key = PackAddr(btAddr) | SLOT_USED;
+    uint32_t pos = hashKey(key, index->mask);
+    while (index->slots[pos].key) {
+        if (index->slots[pos].key == key) {
+            index->slots[pos].key = SLOT_DELETED;
+            index->cnt -= 1;
+            index->deadCnt += 1;
+            return;
+        }
+        pos = (pos + 1) & index->mask;
+    }
+}
+
+void IndexFree(struct BTIndex *index) {
+    free(index->slots);
+    index->slots = NULL;
+    index->mask = 0;
+    index->cnt = 0;
+    index->deadCnt = 0;
+}
+
+static uint32_t hashStr(const char *str) {
+    uint32_t out = 2166136261u;
+    for (; *str; str++)
+        out = (out ^ (uint8_t)*str) * 16777619u;
+    return out;
+}
+
+static void allocArenaSlots(struct StrArena *arena, uint32_t size) {
+    arena->slots = calloc(size, sizeof(uint32_t));
+    if (!arena->slots) {
+        perror("Can't allocate memory");
+        exit(1);
+    }
+    arena->mask = size - 1;
+}
+
+static void growArenaSlots(struct StrArena *arena) {
+    uint32_t *oldSlots = arena->slots;
+    uint32_t oldSize = arena->mask + 1;
+    allocArenaSlots(arena, oldSize * 2);
+    for (uint32_t n = 0; n < oldSize; n++) {
+        if (!oldSlots[n])
+            continue;
+        uint32_t pos = hashStr(arena->buf + oldSlots[n]) & arena->mask;
+        while (arena->slots[pos])
+            pos = (pos + 1) & arena->mask;
+        arena->slots[pos] = oldSlots[n];
+    }
+    free(oldSlots);
+}
+
+void ArenaInit(struct StrArena *arena) {
+    arena->cap = 4096;
+    arena->buf = malloc(arena->cap);
+    if (!arena->buf) {
+        perror("Can't allocate memory");
+        exit(1);
+    }
+    arena->buf[0] = '\0';
+    arena->len = 1;
+    allocArenaSlots(arena, 64);
+    arena->cnt = 0;
+}
+
+// Return the offset of str in the arena, appending it on first use.
+uint32_t ArenaIntern(struct StrArena *arena, const char *str) {
+    if (!str || !str[0])
+        return 0;
+    uint32_t pos = hashStr(str) & arena->mask;
+    while (arena->slots[pos]) {
+        if (strcmp(arena->buf + arena->slots[pos], str) == 0)
+            return arena->slots[pos];
+        pos = (pos + 1) & arena->mask;
+    }
+    uint32_t size = strlen(str) + 1;
+    if (arena->len + size > arena->cap) {
+        while (arena->len + size > arena->cap)
+            arena->cap *= 2;
+        char *newBuf = realloc(arena->buf, arena->cap);
+        if (!newBuf) {
+            printf("Memory reallocation failed.\n");
+            exit(1);
+        }
+        arena->buf = newBuf;
+    }
+    uint32_t off = arena->len;
+    memcpy(arena->buf + off, str, size);
+    arena->len += size;
+    arena->slots[pos] = off;
+    arena->cnt += 1;
+    if (arena->cnt > (arena->mask + 1) / 4 * 3)
+        growArenaSlots(arena);
+    return off;
+}
+
+const char *ArenaStr(struct StrArena *arena, uint32_t off) {
+    return arena->buf + off;
+}
+
+void ArenaFree(struct StrArena *arena) {
+    free(arena->buf);
+    free(arena->slots);
+    memset(arena, 0, sizeof(*arena));
+}
+
+void SymInit(struct SymTab *syms) {
+    ArenaInit(&syms->arena);
+    syms->cap = 64;
+    syms->offs = malloc(syms->cap * sizeof(uint32_t));
+    if (!syms->offs) {
+        perror("Can't allocate memory");
+        exit(1);
+    }
+    syms->offs[0] = 0;
+    syms->cnt = 1;
+}
+
+// Id 0 is the empty string. Arena offsets only grow, so offs stays
+// sorted and an existing id is found by binary search.
+uint16_t SymIntern(struct SymTab *syms, const char *str) {
+    uint32_t len = syms->arena.len;
+    uint32_t off = ArenaIntern(&syms->arena, str);
+    if (off < len) {
+        int lo = 0;
+        int hi = syms->cnt - 1;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (syms->offs[mid] < off)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+    if (syms->cnt == UINT16_MAX) {
+        printf("Too many symbols.\n");
+        exit(1);
+    }
+    if (syms->cnt == syms->cap) {
+        syms->cap = syms->cap > UINT16_MAX / 2 ? UINT16_MAX : syms->cap * 2;
+        uint32_t *newOffs = realloc(syms->offs, syms->cap * sizeof(uint32_t));
+        if (!newOffs) {
+            printf("Memory reallocation failed.\n");
+            exit(1);
+        }
+        syms->offs = newOffs;
+    }
+    syms->offs[syms->cnt] = off;
+    syms->cnt += 1;
+    return syms->cnt - 1;
+}
+
+const char *SymStr(struct SymTab *syms, uint16_t id) {
+    return syms->arena.buf + syms->offs[id];
+}
+
+void SymFree(struct SymTab *syms) {
+    ArenaFree(&syms->arena);
+    free(syms->offs);
+    memset(syms, 0, sizeof(*syms));
+}
+
+void CacheInit(struct BTCache *cache, uint32_t cap) {
+    cache->cap = cap > 64 ? cap : 64;
+    cache->recs = malloc(cache->cap * sizeof(struct BTRecord));
+    if (!cache->recs) {
+        perror("Can't allocate memory");
+        exit(1);
+    }
+    cache->count = 0;
+    IndexInit(&cache->index, cap);
+    ArenaInit(&cache->names);
+    SymInit(&cache->syms);
+}
+
+int CacheFind(struct BTCache *cache, const bdaddr_t *btAddr) {
+    return IndexFind(&cache->index, btAddr);
+}
+
+// Append an empty record for btAddr and return its index.
+int CacheAdd(struct BTCache *cache, const bdaddr_t *btAddr) {
+    if (cache->count == cache->cap) {
+        cache->cap *= 2;
+        struct BTRecord *newRecs = realloc(
+          cache->recs,
+          cache->cap * sizeof(struct BTRecord));
+        if (!newRecs) {
+            printf("Memory reallocation failed.\n");
+            exit(1);
+        }
+        cache->recs = newRecs;
+    }
+    struct BTRecord *rec = &cache->recs[cache->count];
+    memset(rec, 0, sizeof(*rec));
+    bacpy(&rec->addr, btAddr);
+    rec->txPower = TX_POWER_UNKNOWN;
+    IndexPut(&cache->index, btAddr, cache->count);
+    cache->count += 1;
+    return cache->count - 1;
+}
+
+void CacheFree(struct BTCache *cache) {
+    free(cache->recs);
+    IndexFree(&cache->index);
+    ArenaFree(&cache->names);
+    SymFree(&cache->syms);
+}
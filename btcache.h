@@ -0,0 +1,98 @@
+/*
+ * Scan Bluetooth's for Info
+ * Copyright (C) 2025 Hermawan <minghermawan@yahoo.com>
+ * https://www.linkedin.com/in/hermawan-ho-a3801194/
+ * GNU General Public License (GPL) v3.0
+ */
+#include <stdint.h>
+#include <bluetooth/bluetooth.h>
+
+struct BTSlot {
+    uint64_t key;
+    uint32_t idx;
+};
+
+struct BTIndex {
+    struct BTSlot *slots;
+    uint32_t mask;
+    uint32_t cnt;
+    uint32_t deadCnt;
+};
+
+// Interned strings; offset 0 is always the empty string. Strings are
+// never freed, so a name that changes leaves the old one behind: the
+// arena grows by every distinct string seen during a run and starts
+// compact again when the cache is loaded on the next start.
+struct StrArena {
+    char *buf;
+    uint32_t len;
+    uint32_t cap;
+    uint32_t *slots;
+    uint32_t mask;
+    uint32_t cnt;
+};
+
+// Small integer ids for the few hundred type and manufacturer strings.
+struct SymTab {
+    struct StrArena arena;
+    uint32_t *offs;
+    uint16_t cnt;
+    uint16_t cap;
+};
+
+// Fields are ordered by size so a record packs into 52 bytes.
+struct BTRecord {
+    uint32_t nameOff;
+    uint32_t coNameOff;
+    // From Extended Inquiry Response, like txPower.
+    uint32_t uuidsOff;
+    uint32_t nameAt;
+    uint32_t verAt;
+    uint32_t retryAt;
+    uint16_t lmpSubVer;
+    uint16_t typeId;
+    uint16_t manufactureId;
+    // Interrogation outcomes; stage times are averages of successes in ms.
+    uint16_t tryCnt;
+    uint16_t okCnt;
+    uint16_t connMs;
+    uint16_t nameMs;
+    uint16_t verMs;
+    bdaddr_t addr;
+    uint8_t lmpVer;
+    uint8_t failStreak;
+    // TX_POWER_UNKNOWN when the device didn't report it.
+    int8_t txPower;
+};
+
+struct BTCache {
+    struct BTRecord *recs;
+    uint32_t count;
+    uint32_t cap;
+    struct BTIndex index;
+    struct StrArena names;
+    struct SymTab syms;
+};
+
+uint64_t PackAddr(const bdaddr_t *btAddr);
+
+void IndexInit(struct BTIndex *index, uint32_t cap);
+int IndexFind(struct BTIndex *index, const bdaddr_t *btAddr);
+void IndexPut(struct BTIndex *index, const bdaddr_t *btAddr, uint32_t idx);
+void IndexDelete(struct BTIndex *index, const bdaddr_t *btAddr);
+void IndexFree(struct BTIndex *index);
+
+void ArenaInit(struct StrArena *arena);
+uint32_t ArenaIntern(struct StrArena *arena, const char *str);
+const char *ArenaStr(struct StrArena *arena, uint32_t off);
+void ArenaFree(struct StrArena *arena);
+
+void SymInit(struct SymTab *syms);
+uint16_t SymIntern(struct SymTab *syms, const char *str);
+const char *SymStr(struct SymTab *syms, uint16_t id);
+void SymFree(struct SymTab *syms);
+
+void CacheInit(struct BTCache *cache, uint32_t cap);
+int CacheFind(struct BTCache *cache, const bdaddr_t *btAddr);
+int CacheAdd(struct BTCache *cache, const bdaddr_t *btAddr);
+void CacheFree(struct BTCache *cache);
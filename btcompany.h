@@ -0,0 +1,7 @@
+/*
+ * Scan Bluetooth's for Info
+ * Copyright (C) 2025 Hermawan <minghermawan@yahoo.com>
+ * https://www.linkedin.com/in/hermawan-ho-a3801194/
+ * GNU General Public License (GPL) v3.0
+ */
+const char *getManufactureName(int id);
@@ -6,983 +6,361 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdbool.h> 
 #include <unistd.h>
+#include <pthread.h>
 #include <sys/socket.h>
-#include <sys/ioctl.h>
 #include <bluetooth/bluetooth.h>
 #include <bluetooth/hci.h>
 #include <bluetooth/hci_lib.h>
 #include "btinfo.h"
+#include "btmetrics.h"
+#include "btoui.h"
 
-#ifdef HAVE_CONFIG_H
-#include <config.h>
-#endif
-
-#ifdef HAVE_UDEV_HWDB_NEW
-#include <libudev.h>
-
-
+// The caller frees the returned name; NULL when the OUI is unknown.
 char *getCoName(const bdaddr_t *btAddr) {
-    char modalias[11];
-    sprintf(
-      modalias,
-      "OUI:%2.2X%2.2X%2.2X",
-      btAddr->b[5],
-      btAddr->b[4],
-      btAddr->b[3]);
-
-    struct udev *udev = udev_new();
-    if (!udev)
+    uint32_t oui = (btAddr->b[5] << 16) | (btAddr->b[4] << 8) | btAddr->b[3];
+    int len;
+    uint64_t startUs = MetricNow();
+    const char *name = FindOUI(oui, &len);
+    MetricSince(HIST_OUI, startUs);
+    if (!name)
         return NULL;
+    return strndup(name, len);
+}
 
-    struct udev_hwdb *hwdb = udev_hwdb_new(udev);
-    if (!hwdb)
-        goto done;
-
-    struct udev_list_entry *head = udev_hwdb_get_properties_list_entry(
-      hwdb,
-      modalias,
-      0);
-
-    char *out = NULL;
-    struct udev_list_entry *listEntry;
-    udev_list_entry_foreach(listEntry, head) {
-        const char *name = udev_list_entry_get_name(listEntry);
-        if (name && !strcmp(name, "ID_OUI_FROM_DATABASE")) {
-            out = strdup(udev_list_entry_get_value(listEntry));
-            break;
+// DEVICE TYPE Area BEGIN
+
+static const char *const majorNames[32] = {
+    [0x00] = "Miscellaneous",
+    [0x01] = "Computer (desktop, notebook, PDA, organizers)",
+    [0x02] = "Phone (cellular, cordless, payphone, modem)",
+    [0x03] = "LAN /Network Access point",
+    [0x04] = "Audio/Video (headset, speaker, stereo, video, vcr)",
+    [0x05] = "Peripheral (mouse, joystick, keyboards)",
+    [0x06] = "Imaging (printing, scanner, camera, display)",
+    [0x07] = "Wearable",
+    [0x08] = "Toy",
+    [0x09] = "Health",
+    [0x1f] = "Uncategorized, specific device code not specified"
+};
+
+static const char *const computerMinors[64] = {
+    [0x00] = "Uncategorized, code for device not assigned",
+    [0x01] = "Desktop workstation",
+    [0x02] = "Server-class computer",
+    [0x03] = "Laptop",
+    [0x04] = "Handheld PC/PDA (clam shell)",
+    [0x05] = "Palm sized PC/PDA",
+    [0x06] = "Wearable computer (Watch sized)",
+    [0x07] = "Tablet"
+};
+
+static const char *const phoneMinors[64] = {
+    [0x00] = "Uncategorized, code for device not assigned",
+    [0x01] = "Cellular",
+    [0x02] = "Cordless",
+    [0x03] = "Smart phone",
+    [0x04] = "Wired modem or voice gateway",
+    [0x05] = "Common ISDN Access"
+};
+
+static const char *const lanLoads[8] = {
+    "Fully available",
+    "1% to 17% utilized",
+    "17% to 33% utilized",
+    "33% to 50% utilized",
+    "50% to 67% utilized",
+    "67% to 83% utilized",
+    "83% to 99% utilized",
+    "No service available"
+};
+
+static const char *const avMinors[64] = {
+    [0x00] = "Uncategorized, code for device not assigned",
+    [0x01] = "Wearable Headset Device",
+    [0x02] = "Hands-free Device",
+    [0x04] = "Microphone",
+    [0x05] = "Loudspeaker",
+    [0x06] = "Headphones",
+    [0x07] = "Portable Audio",
+    [0x08] = "Car audio",
+    [0x09] = "Set-top box",
+    [0x0a] = "HiFi Audio Device",
+    [0x0b] = "VCR",
+    [0x0c] = "Video Camera",
+    [0x0d] = "Camcorder",
+    [0x0e] = "Video Monitor",
+    [0x0f] = "Video Display and Loudspeaker",
+    [0x10] = "Video Conferencing",
+    [0x12] = "Gaming/Toy"
+};
+
+static const char *const peripheralKinds[4] = {
+    NULL,
+    "Keyboard",
+    "Pointing device",
+    "Keyboard/pointing device"
+};
+
+static const char *const peripheralMinors[16] = {
+    [0x01] = "Joystick",
+    [0x02] = "Gamepad",
+    [0x03] = "Remote control",
+    [0x04] = "Sensing device",
+    [0x05] = "Digitizer tablet",
+    [0x06] = "Card reader",
+    [0x07] = "Digital pen",
+    [0x08] = "Handheld scanner",
+    [0x09] = "Gestural input device"
+};
+
+static const char *const imagingKinds[4] = {
+    "Display",
+    "Camera",
+    "Scanner",
+    "Printer"
+};
+
+static const char *const wearableMinors[64] = {
+    [0x01] = "Wrist Watch",
+    [0x02] = "Pager",
+    [0x03] = "Jacket",
+    [0x04] = "Helmet",
+    [0x05] = "Glasses"
+};
+
+static const char *const toyMinors[64] = {
+    [0x01] = "Robot",
+    [0x02] = "Vehicle",
+    [0x03] = "Doll/Action figure",
+    [0x04] = "Controller",
+    [0x05] = "Game"
+};
+
+static const char *const healthMinors[64] = {
+    [0x01] = "Blood Pressure Monitor",
+    [0x02] = "Thermometer",
+    [0x03] = "Weighing Scale",
+    [0x04] = "Glucose Meter",
+    [0x05] = "Pulse Oximeter",
+    [0x06] = "Heart/Pulse Rate Monitor",
+    [0x07] = "Health Data Display",
+    [0x08] = "Step Counter",
+    [0x09] = "Body Composition Analyzer",
+    [0x0a] = "Peak Flow Monitor",
+    [0x0b] = "Medication Monitor",
+    [0x0c] = "Knee Prosthesis",
+    [0x0d] = "Ankle Prosthesis",
+    [0x0e] = "Generic Health Manager",
+    [0x0f] = "Personal Mobility Device"
+};
+
+static const char *const serviceNames[11] = {
+    "Limited Discoverable",
+    "LE Audio",
+    NULL,
+    "Positioning",
+    "Networking",
+    "Rendering",
+    "Capturing",
+    "Object Transfer",
+    "Audio",
+    "Telephony",
+    "Information"
+};
+
+// Every major/minor pair maps to an id of one of the distinct names.
+static char typeNames[256][50];
+static uint16_t typeNameCnt = 0;
+static uint16_t typeIds[32 * 64];
+static pthread_once_t typeOnce = PTHREAD_ONCE_INIT;
+
+static void formatType(uint8_t major, uint8_t minor, char out[50]) {
+    const char *name = NULL;
+    switch (major) {
+      case 0x01:
+        name = computerMinors[minor];
+        break;
+      case 0x02:
+        name = phoneMinors[minor];
+        break;
+      case 0x03:
+        if (!(minor & 0x07)) {
+            snprintf(
+              out,
+              50,
+              "Network access point, %s",
+              lanLoads[minor >> 3]);
+            return;
+        }
+        break;
+      case 0x04:
+        name = avMinors[minor];
+        break;
+      case 0x05: {
+        const char *kind = peripheralKinds[minor >> 4];
+        const char *sub = peripheralMinors[minor & 0x0f];
+        if (kind && sub) {
+            snprintf(out, 50, "%s, %s", kind, sub);
+            return;
+        }
+        name = kind ? kind : sub;
+        break;
+      }
+      case 0x06: {
+        out[0] = '\0';
+        for (int n = 0; n < 4; n++) {
+            if (!(minor & (0x04 << n)))
+                continue;
+            if (out[0])
+                strcat(out, "/");
+            strcat(out, imagingKinds[n]);
         }
+        if (out[0])
+            return;
+        break;
+      }
+      case 0x07:
+        name = wearableMinors[minor];
+        break;
+      case 0x08:
+        name = toyMinors[minor];
+        break;
+      case 0x09:
+        name = healthMinors[minor];
+        break;
     }
-
-    hwdb = udev_hwdb_unref(hwdb);
-
-done:
-
-    udev = udev_unref(udev);
-
-    return out;
-}
-#else
-char *getCoName(const bdaddr_t *btAddr) {
-    return NULL;
+    if (!name)
+        name = majorNames[major] ? majorNames[major] : "Reserved";
+    snprintf(out, 50, "%s", name);
 }
-#endif
-
-static int getConnection(int s, int devId, long arg) {
-    struct hci_conn_list_req *hciConnListReq;
-    struct hci_conn_info *hciConnInfo;
-
-    if (
-      !(hciConnListReq = malloc(
-        10 * sizeof(*hciConnInfo) + sizeof(*hciConnListReq)
-      ))
-    ) {
-        perror("Can't allocate memory");
-        exit(1);
-    }
 
-    hciConnListReq->dev_id = devId;
-    hciConnListReq->conn_num = 10;
-    hciConnInfo = hciConnListReq->conn_info;
-
-    if (ioctl(s, HCIGETCONNLIST, (void *) hciConnListReq)) {
-        perror("Can't get connection list");
-        exit(1);
+static void buildTypes() {
+    for (int code = 0; code < 32 * 64; code++) {
+        char name[50];
+        formatType(code >> 6, code & 0x3f, name);
+        uint16_t id = 0;
+        while ((id < typeNameCnt) && strcmp(typeNames[id], name))
+            id++;
+        if (id == typeNameCnt) {
+            strcpy(typeNames[id], name);
+            typeNameCnt += 1;
+        }
+        typeIds[code] = id;
     }
+}
 
-    for (int i = 0; i < hciConnListReq->conn_num; i++, hciConnInfo++)
-        if (!bacmp((bdaddr_t *) arg, &hciConnInfo->bdaddr)) {
-            free(hciConnListReq);
-            return 1;
-        }
+// Decode the major/minor device class of a Class of Device into the id
+// of its type name; the table is built on first use.
+uint16_t getTypeId(const uint8_t devClass[3]) {
+    pthread_once(&typeOnce, buildTypes);
+    uint8_t majorClass = devClass[1] & 0x1f;
+    uint8_t minorClass = (devClass[0] & 0xfc) >> 2;
+    return typeIds[(majorClass << 6) | minorClass];
+}
 
-    free(hciConnListReq);
-    return 0;
+const char *getTypeName(uint16_t typeId) {
+    pthread_once(&typeOnce, buildTypes);
+    if (typeId >= typeNameCnt)
+        return "";
+    return typeNames[typeId];
 }
 
-void getType(inquiry_info *inquiryInfo, char out[50]) {
-    uint8_t devClass0 = (uint8_t)(inquiryInfo->dev_class[0]);
-    uint8_t devClass1 = (uint8_t)(inquiryInfo->dev_class[1]);
-    uint8_t majorClass = devClass1 & 0x1f;
-    uint8_t minorClass = (devClass0 & 0xfc) >> 2;
+uint16_t getServices(const uint8_t devClass[3]) {
+    return ((devClass[2] << 16) | (devClass[1] << 8)) >> 13;
+}
 
-    for (int n = 0; majorClassTbl[n].str; n++) {
-        if (majorClassTbl[n].val == majorClass) {
-            if(!majorClassTbl[n].func) {
-                strcpy(out, majorClassTbl[n].str);
-                break;
-            }
-            strcpy(out, majorClassTbl[n].func(minorClass));
+void getServiceNames(uint16_t services, char *out, size_t len) {
+    size_t used = 0;
+    out[0] = '\0';
+    for (int n = 0; n < 11; n++) {
+        if (!(services & (1 << n)) || !serviceNames[n])
+            continue;
+        if (used >= len)
             break;
-        }
+        used += snprintf(
+          out + used,
+          len - used,
+          "%s%s",
+          used ? ", " : "",
+          serviceNames[n]);
     }
 }
 
-void getManufactureName(int id, char out[49]) {
-    switch (id) {
-      case 0:
-        strcpy(out, "Ericsson Technology Licensing");
-        return;
-      case 1:
-        strcpy(out, "Nokia Mobile Phones");
-        return;
-      case 2:
-        strcpy(out, "Intel Corp.");
-        return;
-      case 3:
-        strcpy(out, "IBM Corp.");
-        return;
-      case 4:
-        strcpy(out, "Toshiba Corp.");
-        return;
-      case 5:
-        strcpy(out, "3Com");
-        return;
-      case 6:
-        strcpy(out, "Microsoft");
-        return;
-      case 7:
-        strcpy(out, "Lucent");
-        return;
-      case 8:
-        strcpy(out, "Motorola");
-        return;
-      case 9:
-        strcpy(out, "Infineon Technologies AG");
-        return;
-      case 10:
-        strcpy(out, "Cambridge Silicon Radio");
-        return;
-      case 11:
-        strcpy(out, "Silicon Wave");
-        return;
-      case 12:
-        strcpy(out, "Digianswer A/S");
-        return;
-      case 13:
-        strcpy(out, "Texas Instruments Inc.");
-        return;
-      case 14:
-        strcpy(out, "Ceva, Inc. (formerly Parthus Technologies, Inc.)");
-        return;
-      case 15:
-        strcpy(out, "Broadcom Corporation");
-        return;
-      case 16:
-        strcpy(out, "Mitel Semiconductor");
-        return;
-      case 17:
-        strcpy(out, "Widcomm, Inc");
-        return;
-      case 18:
-        strcpy(out, "Zeevo, Inc.");
-        return;
-      case 19:
-        strcpy(out, "Atmel Corporation");
-        return;
-      case 20:
-        strcpy(out, "Mitsubishi Electric Corporation");
-        return;
-      case 21:
-        strcpy(out, "RTX Telecom A/S");
-        return;
-      case 22:
-        strcpy(out, "KC Technology Inc.");
-        return;
-      case 23:
-        strcpy(out, "NewLogic");
-        return;
-      case 24:
-        strcpy(out, "Transilica, Inc.");
-        return;
-      case 25:
-        strcpy(out, "Rohde & Schwarz GmbH & Co. KG");
-        return;
-      case 26:
-        strcpy(out, "TTPCom Limited");
-        return;
-      case 27:
-        strcpy(out, "Signia Technologies, Inc.");
-        return;
-      case 28:
-        strcpy(out, "Conexant Systems Inc.");
-        return;
-      case 29:
-        strcpy(out, "Qualcomm");
-        return;
-      case 30:
-        strcpy(out, "Inventel");
-        return;
-      case 31:
-        strcpy(out, "AVM Berlin");
-        return;
-      case 32:
-        strcpy(out, "BandSpeed, Inc.");
-        return;
-      case 33:
-        strcpy(out, "Mansella Ltd");
-        return;
-      case 34:
-        strcpy(out, "NEC Corporation");
-        return;
-      case 35:
-        strcpy(out, "WavePlus Technology Co., Ltd.");
-        return;
-      case 36:
-        strcpy(out, "Alcatel");
-        return;
-      case 37:
-        strcpy(out, "Philips Semiconductors");
-        return;
-      case 38:
-        strcpy(out, "C Technologies");
-        return;
-      case 39:
-        strcpy(out, "Open Interface");
-        return;
-      case 40:
-        strcpy(out, "R F Micro Devices");
-        return;
-      case 41:
-        strcpy(out, "Hitachi Ltd");
-        return;
-      case 42:
-        strcpy(out, "Symbol Technologies, Inc.");
-        return;
-      case 43:
-        strcpy(out, "Tenovis");
-        return;
-      case 44:
-        strcpy(out, "Macronix International Co. Ltd.");
-        return;
-      case 45:
-        strcpy(out, "GCT Semiconductor");
-        return;
-      case 46:
-        strcpy(out, "Norwood Systems");
-        return;
-      case 47:
-        strcpy(out, "MewTel Technology Inc.");
-        return;
-      case 48:
-        strcpy(out, "ST Microelectronics");
-        return;
-      case 49:
-        strcpy(out, "Synopsis");
-        return;
-      case 50:
-        strcpy(out, "Red-M (Communications) Ltd");
-        return;
-      case 51:
-        strcpy(out, "Commil Ltd");
-        return;
-      case 52:
-        strcpy(out, "Computer Access Technology Corporation (CATC)");
-        return;
-      case 53:
-        strcpy(out, "Eclipse (HQ Espana) S.L.");
-        return;
-      case 54:
-        strcpy(out, "Renesas Technology Corp.");
-        return;
-      case 55:
-        strcpy(out, "Mobilian Corporation");
-        return;
-      case 56:
-        strcpy(out, "Terax");
-        return;
-      case 57:
-        strcpy(out, "Integrated System Solution Corp.");
-        return;
-      case 58:
-        strcpy(out, "Matsushita Electric Industrial Co., Ltd.");
-        return;
-      case 59:
-        strcpy(out, "Gennum Corporation");
-        return;
-      case 60:
-        strcpy(out, "Research In Motion");
-        return;
-      case 61:
-        strcpy(out, "IPextreme, Inc.");
-        return;
-      case 62:
-        strcpy(out, "Systems and Chips, Inc.");
-        return;
-      case 63:
-        strcpy(out, "Bluetooth SIG, Inc.");
-        return;
-      case 64:
-        strcpy(out, "Seiko Epson Corporation");
-        return;
-      case 65:
-        strcpy(out, "Integrated Silicon Solution Taiwan, Inc.");
-        return;
-      case 66:
-        strcpy(out, "CONWISE Technology Corporation Ltd");
-        return;
-      case 67:
-        strcpy(out, "PARROT SA");
-        return;
-      case 68:
-        strcpy(out, "Socket Mobile");
-        return;
-      case 69:
-        strcpy(out, "Atheros Communications, Inc.");
-        return;
-      case 70:
-        strcpy(out, "MediaTek, Inc.");
-        return;
-      case 71:
-        strcpy(out, "Bluegiga");
-        return;
-      case 72:
-        strcpy(out, "Marvell Technology Group Ltd.");
-        return;
-      case 73:
-        strcpy(out, "3DSP Corporation");
-        return;
-      case 74:
-        strcpy(out, "Accel Semiconductor Ltd.");
-        return;
-      case 75:
-        strcpy(out, "Continental Automotive Systems");
-        return;
-      case 76:
-        strcpy(out, "Apple, Inc.");
-        return;
-      case 77:
-        strcpy(out, "Staccato Communications, Inc.");
-        return;
-      case 78:
-        strcpy(out, "Avago Technologies");
-        return;
-      case 79:
-        strcpy(out, "APT Licensing Ltd.");
-        return;
-      case 80:
-        strcpy(out, "SiRF Technology");
-        return;
-      case 81:
-        strcpy(out, "Tzero Technologies, Inc.");
-        return;
-      case 82:
-        strcpy(out, "J&M Corporation");
-        return;
-      case 83:
-        strcpy(out, "Free2move AB");
-        return;
-      case 84:
-        strcpy(out, "3DiJoy Corporation");
-        return;
-      case 85:
-        strcpy(out, "Plantronics, Inc.");
-        return;
-      case 86:
-        strcpy(out, "Sony Ericsson Mobile Communications");
-        return;
-      case 87:
-        strcpy(out, "Harman International Industries, Inc.");
-        return;
-      case 88:
-        strcpy(out, "Vizio, Inc.");
-        return;
-      case 89:
-        strcpy(out, "Nordic Semiconductor ASA");
-        return;
-      case 90:
-        strcpy(out, "EM Microelectronic-Marin SA");
-        return;
-      case 91:
-        strcpy(out, "Ralink Technology Corporation");
-        return;
-      case 92:
-        strcpy(out, "Belkin International, Inc.");
-        return;
-      case 93:
-        strcpy(out, "Realtek Semiconductor Corporation");
-        return;
-      case 94:
-        strcpy(out, "Stonestreet One, LLC");
-        return;
-      case 95:
-        strcpy(out, "Wicentric, Inc.");
-        return;
-      case 96:
-        strcpy(out, "RivieraWaves S.A.S");
-        return;
-      case 97:
-        strcpy(out, "RDA Microelectronics");
-        return;
-      case 98:
-        strcpy(out, "Gibson Guitars");
-        return;
-      case 99:
-        strcpy(out, "MiCommand Inc.");
-        return;
-      case 100:
-        strcpy(out, "Band XI International, LLC");
-        return;
-      case 101:
-        strcpy(out, "Hewlett-Packard Company");
-        return;
-      case 102:
-        strcpy(out, "9Solutions Oy");
-        return;
-      case 103:
-        strcpy(out, "GN Netcom A/S");
-        return;
-      case 104:
-        strcpy(out, "General Motors");
-        return;
-      case 105:
-        strcpy(out, "A&D Engineering, Inc.");
-        return;
-      case 106:
-        strcpy(out, "MindTree Ltd.");
-        return;
-      case 107:
-        strcpy(out, "Polar Electro OY");
-        return;
-      case 108:
-        strcpy(out, "Beautiful Enterprise Co., Ltd.");
-        return;
-      case 109:
-        strcpy(out, "BriarTek, Inc.");
-        return;
-      case 110:
-        strcpy(out, "Summit Data Communications, Inc.");
-        return;
-      case 111:
-        strcpy(out, "Sound ID");
-        return;
-      case 112:
-        strcpy(out, "Monster, LLC");
-        return;
-      case 113:
-        strcpy(out, "connectBlue AB");
-        return;
-      case 114:
-        strcpy(out, "ShangHai Super Smart Electronics Co. Ltd.");
-        return;
-      case 115:
-        strcpy(out, "Group Sense Ltd.");
-        return;
-      case 116:
-        strcpy(out, "Zomm, LLC");
-        return;
-      case 117:
-        strcpy(out, "Samsung Electronics Co. Ltd.");
-        return;
-      case 118:
-        strcpy(out, "Creative Technology Ltd.");
-        return;
-      case 119:
-        strcpy(out, "Laird Technologies");
-        return;
-      case 120:
-        strcpy(out, "Nike, Inc.");
-        return;
-      case 121:
-        strcpy(out, "lesswire AG");
-        return;
-      case 122:
-        strcpy(out, "MStar Semiconductor, Inc.");
-        return;
-      case 123:
-        strcpy(out, "Hanlynn Technologies");
-        return;
-      case 124:
-        strcpy(out, "A & R Cambridge");
-        return;
-      case 125:
-        strcpy(out, "Seers Technology Co. Ltd");
-        return;
-      case 126:
-        strcpy(out, "Sports Tracking Technologies Ltd.");
-        return;
-      case 127:
-        strcpy(out, "Autonet Mobile");
-        return;
-      case 128:
-        strcpy(out, "DeLorme Publishing Company, Inc.");
-        return;
-      case 129:
-        strcpy(out, "WuXi Vimicro");
-        return;
-      case 130:
-        strcpy(out, "Sennheiser Communications A/S");
-        return;
-      case 131:
-        strcpy(out, "TimeKeeping Systems, Inc.");
-        return;
-      case 132:
-        strcpy(out, "Ludus Helsinki Ltd.");
-        return;
-      case 133:
-        strcpy(out, "BlueRadios, Inc.");
-        return;
-      case 134:
-        strcpy(out, "equinox AG");
-        return;
-      case 135:
-        strcpy(out, "Garmin International, Inc.");
-        return;
-      case 136:
-        strcpy(out, "Ecotest");
-        return;
-      case 137:
-        strcpy(out, "GN ReSound A/S");
-        return;
-      case 138:
-        strcpy(out, "Jawbone");
-        return;
-      case 139:
-        strcpy(out, "Topcorn Positioning Systems, LLC");
-        return;
-      case 140:
-        strcpy(out, "Qualcomm Labs, Inc.");
-        return;
-      case 141:
-        strcpy(out, "Zscan Software");
-        return;
-      case 142:
-        strcpy(out, "Quintic Corp.");
-        return;
-      case 143:
-        strcpy(out, "Stollman E+V GmbH");
-        return;
-      case 144:
-        strcpy(out, "Funai Electric Co., Ltd.");
-        return;
-      case 145:
-        strcpy(out, "Advanced PANMOBIL Systems GmbH & Co. KG");
-        return;
-      case 146:
-        strcpy(out, "ThinkOptics, Inc.");
-        return;
-      case 147:
-        strcpy(out, "Universal Electronics, Inc.");
-        return;
-      case 148:
-        strcpy(out, "Airoha Technology Corp.");
-        return;
-      case 149:
-        strcpy(out, "NEC Lighting, Ltd.");
-        return;
-      case 150:
-        strcpy(out, "ODM Technology, Inc.");
-        return;
-      case 151:
-        strcpy(out, "ConnecteDevice Ltd.");
-        return;
-      case 152:
-        strcpy(out, "zer01.tv GmbH");
-        return;
-      case 153:
-        strcpy(out, "i.Tech Dynamic Global Distribution Ltd.");
-        return;
-      case 154:
-        strcpy(out, "Alpwise");
-        return;
-      case 155:
-        strcpy(out, "Jiangsu Toppower Automotive Electronics Co., Ltd.");
-        return;
-      case 156:
-        strcpy(out, "Colorfy, Inc.");
-        return;
-      case 157:
-        strcpy(out, "Geoforce Inc.");
-        return;
-      case 158:
-        strcpy(out, "Bose Corporation");
-        return;
-      case 159:
-        strcpy(out, "Suunto Oy");
-        return;
-      case 160:
-        strcpy(out, "Kensington Computer Products Group");
-        return;
-      case 161:
-        strcpy(out, "SR-Medizinelektronik");
-        return;
-      case 162:
-        strcpy(out, "Vertu Corporation Limited");
-        return;
-      case 163:
-        strcpy(out, "Meta Watch Ltd.");
-        return;
-      case 164:
-        strcpy(out, "LINAK A/S");
-        return;
-      case 165:
-        strcpy(out, "OTL Dynamics LLC");
-        return;
-      case 166:
-        strcpy(out, "Panda Ocean Inc.");
-        return;
-      case 167:
-        strcpy(out, "Visteon Corporation");
-        return;
-      case 168:
-        strcpy(out, "ARP Devices Limited");
-        return;
-      case 169:
-        strcpy(out, "Magneti Marelli S.p.A");
-        return;
-      case 170:
-        strcpy(out, "CAEN RFID srl");
-        return;
-      case 171:
-        strcpy(out, "Ingenieur-Systemgruppe Zahn GmbH");
-        return;
-      case 172:
-        strcpy(out, "Green Throttle Games");
-        return;
-      case 173:
-        strcpy(out, "Peter Systemtechnik GmbH");
-        return;
-      case 174:
-        strcpy(out, "Omegawave Oy");
-        return;
-      case 175:
-        strcpy(out, "Cinetix");
-        return;
-      case 176:
-        strcpy(out, "Passif Semiconductor Corp");
-        return;
-      case 177:
-        strcpy(out, "Saris Cycling Group, Inc");
-        return;
-      case 178:
-        strcpy(out, "Bekey A/S");
-        return;
-      case 179:
-        strcpy(out, "Clarinox Technologies Pty. Ltd.");
-        return;
-      case 180:
-        strcpy(out, "BDE Technology Co., Ltd.");
-        return;
-      case 181:
-        strcpy(out, "Swirl Networks");
-        return;
-      case 182:
-        strcpy(out, "Meso international");
-        return;
-      case 183:
-        strcpy(out, "TreLab Ltd");
-        return;
-      case 184:
-        strcpy(out, "Qualcomm Innovation Center, Inc. (QuIC)");
-        return;
-      case 185:
-        strcpy(out, "Johnson Controls, Inc.");
-        return;
-      case 186:
-        strcpy(out, "Starkey Laboratories Inc.");
-        return;
-      case 187:
-        strcpy(out, "S-Power Electronics Limited");
-        return;
-      case 188:
-        strcpy(out, "Ace Sensor Inc");
-        return;
-      case 189:
-        strcpy(out, "Aplix Corporation");
-        return;
-      case 190:
-        strcpy(out, "AAMP of America");
-        return;
-      case 191:
-        strcpy(out, "Stalmart Technology Limited");
-        return;
-      case 192:
-        strcpy(out, "AMICCOM Electronics Corporation");
-        return;
-      case 193:
-        strcpy(out, "Shenzhen Excelsecu Data Technology Co.,Ltd");
-        return;
-      case 194:
-        strcpy(out, "Geneq Inc.");
-        return;
-      case 195:
-        strcpy(out, "adidas AG");
-        return;
-      case 196:
-        strcpy(out, "LG Electronics");
-        return;
-      case 197:
-        strcpy(out, "Onset Computer Corporation");
-        return;
-      case 198:
-        strcpy(out, "Selfly BV");
-        return;
-      case 199:
-        strcpy(out, "Quuppa Oy.");
-        return;
-      case 200:
-        strcpy(out, "GeLo Inc");
-        return;
-      case 201:
-        strcpy(out, "Evluma");
-        return;
-      case 202:
-        strcpy(out, "MC10");
-        return;
-      case 203:
-        strcpy(out, "Binauric SE");
-        return;
-      case 204:
-        strcpy(out, "Beats Electronics");
-        return;
-      case 205:
-        strcpy(out, "Microchip Technology Inc.");
-        return;
-      case 206:
-        strcpy(out, "Elgato Systems GmbH");
-        return;
-      case 207:
-        strcpy(out, "ARCHOS SA");
-        return;
-      case 209:
-        strcpy(out, "Polar Electro Europe B.V.");
-        return;
-      case 210:
-        strcpy(out, "Dialog Semiconductor B.V.");
-        return;
-      case 211:
-        strcpy(out, "Taixingbang Technology (HK) Co,. LTD.");
-        return;
-      case 212:
-        strcpy(out, "Kawantech");
-        return;
-      case 213:
-        strcpy(out, "Austco Communication Systems");
-        return;
-      case 214:
-        strcpy(out, "Timex Group USA, Inc.");
-        return;
-      case 215:
-        strcpy(out, "Qualcomm Technologies, Inc.");
-        return;
-      case 216:
-        strcpy(out, "Qualcomm Connected Experiences, Inc.");
-        return;
-      case 217:
-        strcpy(out, "Voyetra Turtle Beach");
-        return;
-      case 218:
-        strcpy(out, "txtr GmbH");
-        return;
-      case 219:
-        strcpy(out, "Biosentronics");
-        return;
-      case 220:
-        strcpy(out, "Procter & Gamble");
-        return;
-      case 221:
-        strcpy(out, "Hosiden Corporation");
-        return;
-      case 222:
-        strcpy(out, "Muzik LLC");
-        return;
-      case 223:
-        strcpy(out, "Misfit Wearables Corp");
-        return;
-      case 224:
-        strcpy(out, "Google");
-        return;
-      case 225:
-        strcpy(out, "Danlers Ltd");
-        return;
-      case 226:
-        strcpy(out, "Semilink Inc");
-        return;
-      case 227:
-        strcpy(out, "inMusic Brands, Inc");
-        return;
-      case 228:
-        strcpy(out, "L.S. Research Inc.");
-        return;
-      case 229:
-        strcpy(out, "Eden Software Consultants Ltd.");
-        return;
-      case 230:
-        strcpy(out, "Freshtemp");
-        return;
-      case 231:
-        strcpy(out, "KS Technologies");
-        return;
-      case 232:
-        strcpy(out, "ACTS Technologies");
-        return;
-      case 233:
-        strcpy(out, "Vtrack Systems");
-        return;
-      case 234:
-        strcpy(out, "Nielsen-Kellerman Company");
-        return;
-      case 235:
-        strcpy(out, "Server Technology, Inc.");
-        return;
-      case 236:
-        strcpy(out, "BioResearch Associates");
-        return;
-      case 237:
-        strcpy(out, "Jolly Logic, LLC");
-        return;
-      case 238:
-        strcpy(out, "Above Average Outcomes, Inc.");
-        return;
-      case 239:
-        strcpy(out, "Bitsplitters GmbH");
-        return;
-      case 240:
-        strcpy(out, "PayPal, Inc.");
-        return;
-      case 241:
-        strcpy(out, "Witron Technology Limited");
-        return;
-      case 242:
-        strcpy(out, "Morse Project Inc.");
-        return;
-      case 243:
-        strcpy(out, "Kent Displays Inc.");
-        return;
-      case 244:
-        strcpy(out, "Nautilus Inc.");
-        return;
-      case 245:
-        strcpy(out, "Smartifier Oy");
-        return;
-      case 246:
-        strcpy(out, "Elcometer Limited");
-        return;
-      case 247:
-        strcpy(out, "VSN Technologies Inc.");
-        return;
-      case 248:
-        strcpy(out, "AceUni Corp., Ltd.");
-        return;
-      case 65535:
-        strcpy(out, "internal use");
-        return;
-      default:
-        strcpy(out, "not assigned");
+// DEVICE TYPE Area END
+
+// EIR data types, Bluetooth Core Supplement Part A section 1
+const uint8_t EIR_UUID16_SOME = 0x02;
+const uint8_t EIR_UUID16_ALL = 0x03;
+const uint8_t EIR_UUID32_SOME = 0x04;
+const uint8_t EIR_UUID32_ALL = 0x05;
+const uint8_t EIR_UUID128_SOME = 0x06;
+const uint8_t EIR_UUID128_ALL = 0x07;
+const uint8_t EIR_NAME_SHORT = 0x08;
+const uint8_t EIR_NAME_COMPLETE = 0x09;
+const uint8_t EIR_TX_POWER = 0x0A;
+
+// UUIDs are little endian; 16 and 32 bit ones are written as short hex,
+// 128 bit ones in the usual 8-4-4-4-12 form, separated by commas.
+static void addUUIDs(struct EIRStruct *out,
+                     const uint8_t *data,
+                     int len,
+                     int size) {
+    for (int n1 = 0; n1 + size <= len; n1 += size) {
+        char uuid[37];
+        int pos = 0;
+        for (int n2 = size - 1; n2 >= 0; n2--) {
+            if(
+              (size == 16)
+              && ((n2 == 11) || (n2 == 9) || (n2 == 7) || (n2 == 5))
+            )
+                uuid[pos++] = '-';
+            sprintf(uuid + pos, "%2.2x", data[n1 + n2]);
+            pos += 2;
+        }
+        size_t used = strlen(out->uuids);
+        if (used + pos + 2 > sizeof(out->uuids))
+            return;
+        if (used)
+            out->uuids[used++] = ',';
+        strcpy(out->uuids + used, uuid);
     }
 }
 
-struct InfoStruct getHCIInfo(int devId, char addr[19]) {
-    struct InfoStruct out;
-    strcpy(out.addr, addr);
-    struct hci_version hciVer;
-    uint16_t handle;
-    struct hci_dev_info hciDevInfo;
-    struct hci_conn_info_req *hciConnInfoReq;
-    int cc = 0;
-
-    bdaddr_t btAddr;
-    str2ba(addr, &btAddr);
-
-    if (devId < 0)
-        devId = hci_for_each_dev(HCI_UP, getConnection, (long) &btAddr);
-
-    if (devId < 0)
-        devId = hci_get_route(&btAddr);
-
-    if (devId < 0) {
-        printf("No device available or connected!");
-        exit(1);
-    }
-
-    if (hci_devinfo(devId, &hciDevInfo) < 0) {
-        perror("Can't get device info");
-        exit(1);
-    }
-
-    int devDescriptor = hci_open_dev(devId);
-    if (devDescriptor < 0) {
-        perror("HCI device open failed");
-        exit(1);
-    }
-
-    hciConnInfoReq = malloc(sizeof(*hciConnInfoReq) + sizeof(struct hci_conn_info));
-    if (!hciConnInfoReq) {
-        perror("Can't get connection info");
-        close(devDescriptor);
-        exit(1);
-    }
-
-    bacpy(&hciConnInfoReq->bdaddr, &btAddr);
-    hciConnInfoReq->type = ACL_LINK;
-    if (ioctl(
-      devDescriptor,
-      HCIGETCONNINFO,
-      (unsigned long)hciConnInfoReq) < 0
-    ) {
-        if (hci_create_connection(
-          devDescriptor,
-          &btAddr,
-          htobs(hciDevInfo.pkt_type & ACL_PTYPE_MASK),
-          0,
-          0x01,
-          &handle,
-          25000) < 0
+// Parse the name, TX power and service UUIDs out of Extended Inquiry
+// Response data. A complete name wins over a shortened one.
+void getEIR(const uint8_t *data, int len, struct EIRStruct *out) {
+    memset(out, 0, sizeof(*out));
+    out->txPower = TX_POWER_UNKNOWN;
+    int pos = 0;
+    while (pos < len) {
+        int fieldLen = data[pos];
+        if ((fieldLen == 0) || (pos + 1 + fieldLen > len))
+            break;
+        uint8_t type = data[pos + 1];
+        const uint8_t *field = data + pos + 2;
+        int dataLen = fieldLen - 1;
+        pos += 1 + fieldLen;
+
+        if(
+          (type == EIR_NAME_COMPLETE)
+          || ((type == EIR_NAME_SHORT) && !out->name[0])
         ) {
-            printf("Can't create connection\n");
-            close(devDescriptor);
-            out.isSuccess = false;
-            return out;
+            if (dataLen > (int)sizeof(out->name) - 1)
+                dataLen = sizeof(out->name) - 1;
+            memcpy(out->name, field, dataLen);
+            out->name[dataLen] = '\0';
+            out->isNameComplete = (type == EIR_NAME_COMPLETE);
+        } else if ((type == EIR_TX_POWER) && (dataLen >= 1)) {
+            out->txPower = (int8_t)field[0];
+        } else if ((type == EIR_UUID16_SOME) || (type == EIR_UUID16_ALL)) {
+            addUUIDs(out, field, dataLen, 2);
+        } else if ((type == EIR_UUID32_SOME) || (type == EIR_UUID32_ALL)) {
+            addUUIDs(out, field, dataLen, 4);
+        } else if ((type == EIR_UUID128_SOME) || (type == EIR_UUID128_ALL)) {
+            addUUIDs(out, field, dataLen, 16);
         }
-        sleep(1);
-        cc = 1;
-    } else
-        handle = htobs(hciConnInfoReq->conn_info->handle);
-
-    char *coName = getCoName(&btAddr);
-    char coOUI[9];
-    if (coName) {
-        ba2oui(&btAddr, coOUI);
-        free(coName);
-    }
-
-    char name[249];
-    if (hci_read_remote_name(
-      devDescriptor,
-      &btAddr,
-      sizeof(name),
-      name,
-      25000) == 0
-    ) {
-
-    }
-
-    uint8_t lmpVer;
-    uint16_t lmpSubVer, manufactureId;
-    char manufactureName[49];
-    if (hci_read_remote_version(devDescriptor, handle, &hciVer, 20000) == 0) {
-        char *ver = lmp_vertostr(hciVer.lmp_ver);
-        lmpVer = (uint8_t)(hciVer.lmp_ver);
-        lmpSubVer = (uint16_t)(hciVer.lmp_subver);
-        manufactureId = hciVer.manufacturer;
-        getManufactureName(manufactureId, manufactureName);
-        if (ver)
-            bt_free(ver);
     }
-
-    if (cc) {
-        usleep(10000);
-        hci_disconnect(devDescriptor, handle, HCI_OE_USER_ENDED_CONNECTION, 10000);
-    }
-
-    hci_close_dev(devDescriptor);
-    out.isSuccess = true;
-    strcpy(out.name, name);
-    out.coName = coName;
-    out.lmpVer = lmpVer;
-    out.lmpSubVer = lmpSubVer;
-    if(manufactureName)
-        strcpy(out.manufactureName, manufactureName);
-    return out;
 }
@@ -0,0 +1,256 @@
+/*
+ * Scan Bluetooth's for Info
+ * Copyright (C) 2025 Hermawan <minghermawan@yahoo.com>
+ * https://www.linkedin.com/in/hermawan-ho-a3801194/
+ * GNU General Public License (GPL) v3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include "btlog.h"
+
+const char *LOG_LEVEL_NAMES[] = {"quiet", "status", "devices", NULL};
+const char *LOG_FORMAT_NAMES[] = {"text", "line", NULL};
+
+static struct LogSlot slots[LOG_SLOTS];
+static atomic_size_t tail;
+static size_t head;
+static atomic_size_t droppedCnt;
+static atomic_bool isStopping;
+static enum LogLevel logLevel = LOG_DEVICES;
+static FILE *logOut = NULL;
+static atomic_bool isOpen;
+// Producers between their isOpen check and publishing their message.
+static atomic_int busyCnt;
+static pthread_t writer;
+// The writer sleeps on wakeCond once the ring is empty; producers only
+// take wakeLock to signal it while isWaiting is set.
+static pthread_mutex_t wakeLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wakeCond = PTHREAD_COND_INITIALIZER;
+static atomic_bool isWaiting;
+
+static bool parseName(const char *name, const char *names[], int *out) {
+    for (int n = 0; names[n]; n++) {
+        if (strcmp(name, names[n]) == 0) {
+            *out = n;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ParseLogLevel(const char *name, enum LogLevel *level) {
+    int n;
+    if (!parseName(name, LOG_LEVEL_NAMES, &n))
+        return false;
+    *level = n;
+    return true;
+}
+
+bool ParseLogFormat(const char *name, enum LogFormat *format) {
+    int n;
+    if (!parseName(name, LOG_FORMAT_NAMES, &n))
+        return false;
+    *format = n;
+    return true;
+}
+
+// Write out every message that is ready; only the writer thread, or the
+// closing thread once the writer is gone, takes messages off the ring.
+static bool drain() {
+    bool isAny = false;
+    while (1) {
+        struct LogSlot *slot = &slots[head % LOG_SLOTS];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (seq != head + 1)
+            break;
+        fwrite(slot->buf, 1, slot->len, logOut);
+        atomic_store_explicit(
+          &slot->seq,
+          head + LOG_SLOTS,
+          memory_order_release);
+        head += 1;
+        isAny = true;
+    }
+    size_t dropped = atomic_exchange(&droppedCnt, 0);
+    if (dropped)
+        fprintf(logOut, "Dropped %zu log messages.\n", dropped);
+    if (isAny || dropped)
+        fflush(logOut);
+    return isAny;
+}
+
+static bool isReady() {
+    struct LogSlot *slot = &slots[head % LOG_SLOTS];
+    size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    return seq == head + 1;
+}
+
+static void *runWriter(void *arg) {
+    while (!atomic_load(&isStopping)) {
+        if (drain())
+            continue;
+        pthread_mutex_lock(&wakeLock);
+        atomic_store(&isWaiting, true);
+        // Pairs with the fence in wake(): either the producer sees
+        // isWaiting or this sees its message.
+        atomic_thread_fence(memory_order_seq_cst);
+        if (!isReady() && !atomic_load(&isStopping))
+            pthread_cond_wait(&wakeCond, &wakeLock);
+        atomic_store(&isWaiting, false);
+        pthread_mutex_unlock(&wakeLock);
+    }
+    return NULL;
+}
+
+static void wake() {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!atomic_load(&isWaiting))
+        return;
+    pthread_mutex_lock(&wakeLock);
+    pthread_cond_signal(&wakeCond);
+    pthread_mutex_unlock(&wakeLock);
+}
+
+// Log from here on through a writer thread, so that a slow out never
+// holds up the threads that log.
+bool LogOpen(enum LogLevel level, FILE *out) {
+    logLevel = level;
+    logOut = out;
+    for (size_t n = 0; n < LOG_SLOTS; n++)
+        atomic_init(&slots[n].seq, n);
+    atomic_init(&tail, 0);
+    head = 0;
+    if (pthread_create(&writer, NULL, runWriter, NULL) != 0)
+        return false;
+    atomic_store(&isOpen, true);
+    atexit(LogClose);
+    return true;
+}
+
+bool IsLogged(enum LogLevel level) {
+    return (level != LOG_QUIET) && (level <= logLevel);
+}
+
+// Claim the next free slot, or NULL when the ring is full.
+static struct LogSlot *claim(size_t *pos) {
+    size_t at = atomic_load_explicit(&tail, memory_order_relaxed);
+    while (1) {
+        struct LogSlot *slot = &slots[at % LOG_SLOTS];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (seq == at) {
+            if (atomic_compare_exchange_weak_explicit(
+              &tail,
+              &at,
+              at + 1,
+              memory_order_relaxed,
+              memory_order_relaxed)
+            ) {
+                *pos = at;
+                return slot;
+            }
+        } else if (seq < at) {
+            atomic_fetch_add(&droppedCnt, 1);
+            return NULL;
+        } else {
+            at = atomic_load_explicit(&tail, memory_order_relaxed);
+        }
+    }
+}
+
+static void publish(struct LogSlot *slot, size_t pos, int len) {
+    slot->len = len < LOG_MSG_SIZE ? len : LOG_MSG_SIZE - 1;
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+    wake();
+}
+
+void LogPrint(enum LogLevel level, const char *fmt, ...) {
+    if (!IsLogged(level))
+        return;
+    va_list args;
+    va_start(args, fmt);
+    atomic_fetch_add(&busyCnt, 1);
+    if (!atomic_load(&isOpen)) {
+        atomic_fetch_sub(&busyCnt, 1);
+        vprintf(fmt, args);
+        va_end(args);
+        return;
+    }
+    size_t pos;
+    struct LogSlot *slot = claim(&pos);
+    if (slot)
+        publish(slot, pos, vsnprintf(slot->buf, LOG_MSG_SIZE, fmt, args));
+    atomic_fetch_sub(&busyCnt, 1);
+    va_end(args);
+}
+
+void MsgAdd(struct LogMsg *msg, const char *fmt, ...) {
+    if (msg->len >= LOG_MSG_SIZE - 1)
+        return;
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(
+      msg->buf + msg->len,
+      LOG_MSG_SIZE - msg->len,
+      fmt,
+      args);
+    va_end(args);
+    if (len > 0)
+        msg->len += len;
+    if (msg->len >= LOG_MSG_SIZE)
+        msg->len = LOG_MSG_SIZE - 1;
+}
+
+static void addChar(struct LogMsg *msg, char c) {
+    if (msg->len < LOG_MSG_SIZE - 1)
+        msg->buf[msg->len++] = c;
+}
+
+// Add " key=val", quoting val unless it is a plain word, so that every
+// field of a message stays on one line and splits apart again.
+void MsgAddField(struct LogMsg *msg, const char *key, const char *val) {
+    bool isPlain = val[0] != '\0';
+    for (const char *c = val; *c && isPlain; c++) {
+        if ((*c <= ' ') || (*c == '"') || (*c == '=') || (*c == '\\'))
+            isPlain = false;
+    }
+    if (isPlain) {
+        MsgAdd(msg, " %s=%s", key, val);
+        return;
+    }
+    MsgAdd(msg, " %s=\"", key);
+    for (const char *c = val; *c; c++) {
+        if ((*c == '"') || (*c == '\\')) {
+            addChar(msg, '\\');
+            addChar(msg, *c);
+        } else if ((unsigned char)*c < ' ') {
+            MsgAdd(msg, "\\x%02x", (unsigned char)*c);
+        } else {
+            addChar(msg, *c);
+        }
+    }
+    addChar(msg, '"');
+}
+
+void LogPut(enum LogLevel level, struct LogMsg *msg) {
+    LogPrint(level, "%.*s", (int)msg->len, msg->buf);
+}
+
+// Stop the writer once it has written everything logged so far. Messages
+// logged from here on are printed straight away.
+void LogClose() {
+    if (!atomic_exchange(&isOpen, false))
+        return;
+    while (atomic_load(&busyCnt) > 0)
+        sched_yield();
+    pthread_mutex_lock(&wakeLock);
+    atomic_store(&isStopping, true);
+    pthread_cond_signal(&wakeCond);
+    pthread_mutex_unlock(&wakeLock);
+    pthread_join(writer, NULL);
+    drain();
+    fflush(logOut);
+}
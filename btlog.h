@@ -0,0 +1,52 @@
+/*
+ * Scan Bluetooth's for Info
+ * Copyright (C) 2025 Hermawan <minghermawan@yahoo.com>
+ * https://www.linkedin.com/in/hermawan-ho-a3801194/
+ * GNU General Public License (GPL) v3.0
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <stdio.h>
+
+// Messages wait in a ring of LOG_SLOTS slots of LOG_MSG_SIZE bytes each;
+// longer messages are cut short, and messages that find the ring full are
+// dropped and counted rather than waited for.
+#define LOG_SLOTS 1024
+#define LOG_MSG_SIZE 2048
+
+// Each level logs everything the levels before it do.
+enum LogLevel {
+    LOG_QUIET,
+    LOG_STATUS,
+    LOG_DEVICES
+};
+
+enum LogFormat {
+    LOG_TEXT,
+    LOG_LINE
+};
+
+struct LogSlot {
+    atomic_size_t seq;
+    int len;
+    char buf[LOG_MSG_SIZE];
+};
+
+// A message built up piece by piece before it is logged.
+struct LogMsg {
+    size_t len;
+    char buf[LOG_MSG_SIZE];
+};
+
+bool ParseLogLevel(const char *name, enum LogLevel *level);
+bool ParseLogFormat(const char *name, enum LogFormat *format);
+bool LogOpen(enum LogLevel level, FILE *out);
+bool IsLogged(enum LogLevel level);
+void LogPrint(enum LogLevel level, const char *fmt, ...)
+  __attribute__((format(printf, 2, 3)));
+void MsgAdd(struct LogMsg *msg, const char *fmt, ...)
+  __attribute__((format(printf, 2, 3)));
+void MsgAddField(struct LogMsg *msg, const char *key, const char *val);
+void LogPut(enum LogLevel level, struct LogMsg *msg);
+void LogClose();
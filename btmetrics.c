@@ -0,0 +1,385 @@
+/*
+ * Scan Bluetooth's for Info
+ * Copyright (C) 2025 Hermawan <minghermawan@yahoo.com>
+ * https://www.linkedin.com/in/hermawan-ho-a3801194/
+ * GNU General Public License (GPL) v3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "btmetrics.h"
+
+// Exported bucket bounds run over these powers of two microseconds.
+const int LE_MIN_EXP = 3;
+const int LE_MAX_EXP = 34;
+
+struct MetricInfo {
+    const char *name;
+    const char *label;
+    const char *help;
+};
+
+static const struct MetricInfo COUNTERS[COUNT_MAX] = {
+  [COUNT_FOUND] = {
+    "scanbt_devices_found_total", NULL,
+    "Devices heard by inquiries."},
+  [COUNT_SKIPPED] = {
+    "scanbt_fresh_skips_total", NULL,
+    "Devices not interrogated because their info was fresh."},
+  [COUNT_INTERROGATIONS] = {
+    "scanbt_interrogations_total", NULL,
+    "Finished interrogations."},
+  [COUNT_INTERROGATIONS_OK] = {
+    "scanbt_interrogations_ok_total", NULL,
+    "Interrogations that connected and queried the device."},
+  [COUNT_CONN_FAILS] = {
+    "scanbt_stage_failures_total", "conn",
+    "Stages that failed or timed out."},
+  [COUNT_NAME_FAILS] = {
+    "scanbt_stage_failures_total", "name",
+    "Stages that failed or timed out."},
+  [COUNT_VER_FAILS] = {
+    "scanbt_stage_failures_total", "ver",
+    "Stages that failed or timed out."},
+  [COUNT_CYCLES] = {
+    "scanbt_cycles_total", NULL,
+    "Finished scan cycles."}
+};
+
+static const struct MetricInfo GAUGES[GAUGE_MAX] = {
+  [GAUGE_KNOWN_DEVICES] = {
+    "scanbt_known_devices", NULL,
+    "Devices in the in-memory cache."},
+  [GAUGE_CYCLE_FOUND] = {
+    "scanbt_last_cycle_devices", NULL,
+    "Devices found by the last finished cycle."}
+};
+
+static const char *const HIST_STAGES[HIST_MAX] = {
+  [HIST_CYCLE] = "cycle",
+  [HIST_INQUIRY] = "inquiry",
+  [HIST_CONN] = "conn",
+  [HIST_NAME] = "name",
+  [HIST_VER] = "ver",
+  [HIST_INTERROGATION] = "interrogation",
+  [HIST_OUI] = "oui",
+  [HIST_DB_UPSERT] = "db_upsert",
+  [HIST_DB_SIGHTING] = "db_sighting",
+  [HIST_DB_COMMIT] = "db_commit",
+  [HIST_DB_PRUNE] = "db_prune",
+  [HIST_DB_LOAD] = "db_load"
+};
+
+static const double QUANTILES[] = {0.5, 0.9, 0.99, 0.999};
+
+struct Hist {
+    atomic_uint_fast64_t counts[HIST_BUCKETS];
+    atomic_uint_fast64_t count;
+    atomic_uint_fast64_t sum;
+};
+
+static atomic_uint_fast64_t counters[COUNT_MAX];
+static atomic_int_fast64_t gauges[GAUGE_MAX];
+static struct Hist hists[HIST_MAX];
+
+static int listenFd = -1;
+static char *unixPath = NULL;
+static pthread_t server;
+
+uint64_t MetricNow() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void MetricAdd(enum MetricCounter counter, uint64_t val) {
+    atomic_fetch_add_explicit(&counters[counter], val, memory_order_relaxed);
+}
+
+void MetricSet(enum MetricGauge gauge, int64_t val) {
+    atomic_store_explicit(&gauges[gauge], val, memory_order_relaxed);
+}
+
+static int bucketOf(uint64_t us) {
+    if (us < HIST_SUB)
+        return us;
+    int exp = 63 - __builtin_clzll(us);
+    if (exp > HIST_MAX_EXP)
+        return HIST_BUCKETS - 1;
+    return (exp - HIST_SUB_BITS + 1) * HIST_SUB
+      + ((us >> (exp - HIST_SUB_BITS)) & (HIST_SUB - 1));
+}
+
+// Highest value that falls into a bucket.
+static uint64_t bucketTop(int bucket) {
+    if (bucket < HIST_SUB)
+        return bucket;
+    int exp = bucket / HIST_SUB + HIST_SUB_BITS - 1;
+    uint64_t sub = HIST_SUB + bucket % HIST_SUB;
+    return ((sub + 1) << (exp - HIST_SUB_BITS)) - 1;
+}
+
+void MetricRecord(enum MetricHist hist, uint64_t us) {
+    struct Hist *h = &hists[hist];
+    atomic_fetch_add_explicit(
+      &h->counts[bucketOf(us)],
+      1,
+      memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->sum, us, memory_order_relaxed);
+}
+
+void MetricSince(enum MetricHist hist, uint64_t startUs) {
+    MetricRecord(hist, MetricNow() - startUs);
+}
+
+static void writeHeader(FILE *out,
+                        const char *name,
+                        const char *type,
+                        const char *help) {
+    fprintf(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static void writeHist(FILE *out, int hist) {
+    const char *stage = HIST_STAGES[hist];
+    struct Hist *h = &hists[hist];
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total = 0;
+    for (int n = 0; n < HIST_BUCKETS; n++) {
+        counts[n] = atomic_load_explicit(
+          &h->counts[n],
+          memory_order_relaxed);
+        total += counts[n];
+    }
+    // Bound 2^exp us covers every bucket below its power of two.
+    uint64_t cum = 0;
+    int bucket = 0;
+    for (int exp = LE_MIN_EXP; exp <= LE_MAX_EXP; exp++) {
+        int limit = exp < HIST_SUB_BITS
+          ? 1 << exp
+          : (exp - HIST_SUB_BITS + 1) * HIST_SUB;
+        for (; bucket < limit; bucket++)
+            cum += counts[bucket];
+        fprintf(
+          out,
+          "scanbt_stage_seconds_bucket{stage=\"%s\",le=\"%g\"} %" PRIu64
+          "\n",
+          stage,
+          (double)((uint64_t)1 << exp) / 1e6,
+          cum);
+    }
+    fprintf(
+      out,
+      "scanbt_stage_seconds_bucket{stage=\"%s\",le=\"+Inf\"} %" PRIu64 "\n"
+      "scanbt_stage_seconds_sum{stage=\"%s\"} %.6f\n"
+      "scanbt_stage_seconds_count{stage=\"%s\"} %" PRIu64 "\n",
+      stage,
+      total,
+      stage,
+      atomic_load_explicit(&h->sum, memory_order_relaxed) / 1e6,
+      stage,
+      total);
+}
+
+static void writeQuantiles(FILE *out, int hist) {
+    struct Hist *h = &hists[hist];
+    uint64_t total = 0;
+    uint64_t counts[HIST_BUCKETS];
+    for (int n = 0; n < HIST_BUCKETS; n++) {
+        counts[n] = atomic_load_explicit(
+          &h->counts[n],
+          memory_order_relaxed);
+        total += counts[n];
+    }
+    if (!total)
+        return;
+    for (size_t n1 = 0; n1 < sizeof(QUANTILES) / sizeof(QUANTILES[0]); n1++) {
+        uint64_t rank = (uint64_t)(QUANTILES[n1] * total);
+        if (rank < 1)
+            rank = 1;
+        uint64_t cum = 0;
+        int bucket = 0;
+        while ((bucket < HIST_BUCKETS - 1) && (cum + counts[bucket] < rank))
+            cum += counts[bucket++];
+        fprintf(
+          out,
+          "scanbt_stage_seconds_quantile{stage=\"%s\",quantile=\"%g\"} %g\n",
+          HIST_STAGES[hist],
+          QUANTILES[n1],
+          bucketTop(bucket) / 1e6);
+    }
+}
+
+// Render every metric in the Prometheus text exposition format.
+void MetricsWrite(FILE *out) {
+    const char *lastName = NULL;
+    for (int n = 0; n < COUNT_MAX; n++) {
+        const struct MetricInfo *info = &COUNTERS[n];
+        if (!lastName || strcmp(lastName, info->name))
+            writeHeader(out, info->name, "counter", info->help);
+        lastName = info->name;
+        uint64_t val = atomic_load_explicit(
+          &counters[n],
+          memory_order_relaxed);
+        if (info->label)
+            fprintf(
+              out,
+              "%s{stage=\"%s\"} %" PRIu64 "\n",
+              info->name,
+              info->label,
+              val);
+        else
+            fprintf(out, "%s %" PRIu64 "\n", info->name, val);
+    }
+    for (int n = 0; n < GAUGE_MAX; n++) {
+        writeHeader(out, GAUGES[n].name, "gauge", GAUGES[n].help);
+        fprintf(
+          out,
+          "%s %" PRId64 "\n",
+          GAUGES[n].name,
+          (int64_t)atomic_load_explicit(&gauges[n], memory_order_relaxed));
+    }
+    writeHeader(
+      out,
+      "scanbt_stage_seconds",
+      "histogram",
+      "Time spent per stage.");
+    for (int n = 0; n < HIST_MAX; n++)
+        writeHist(out, n);
+    writeHeader(
+      out,
+      "scanbt_stage_seconds_quantile",
+      "gauge",
+      "Stage time quantiles, to within 1/16.");
+    for (int n = 0; n < HIST_MAX; n++)
+        writeQuantiles(out, n);
+}
+
+static void sendAll(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t sent = send(fd, buf, len, MSG_NOSIGNAL);
+        if (sent <= 0)
+            return;
+        buf += sent;
+        len -= sent;
+    }
+}
+
+// Answer every connection with the metrics; the request is not parsed.
+static void *serve(void *arg) {
+    (void)arg;
+    while (1) {
+        int fd = accept(listenFd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR)
+                continue;
+            return NULL;
+        }
+        struct timeval timeout = {1, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        char req[1024];
+        if (recv(fd, req, sizeof(req), 0) < 0)
+            req[0] = '\0';
+
+        char *body = NULL;
+        size_t len = 0;
+        FILE *out = open_memstream(&body, &len);
+        if (out) {
+            MetricsWrite(out);
+            fclose(out);
+            char head[128];
+            int headLen = snprintf(
+              head,
+              sizeof(head),
+              "HTTP/1.0 200 OK\r\n"
+              "Content-Type: text/plain; version=0.0.4\r\n"
+              "Content-Length: %zu\r\n\r\n",
+              len);
+            sendAll(fd, head, headLen);
+            sendAll(fd, body, len);
+            free(body);
+        }
+        close(fd);
+    }
+}
+
+// Serve the metrics over HTTP on a local port, or on a Unix socket when
+// addr is a path.
+bool MetricsServe(const char *addr) {
+    if (addr[0] == '/') {
+        struct sockaddr_un sockAddr;
+        memset(&sockAddr, 0, sizeof(sockAddr));
+        sockAddr.sun_family = AF_UNIX;
+        if (strlen(addr) >= sizeof(sockAddr.sun_path)) {
+            errno = ENAMETOOLONG;
+            return false;
+        }
+        strcpy(sockAddr.sun_path, addr);
+        listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        // Only replace a socket left behind by an earlier run; bind fails
+        // on anything else.
+        struct stat st;
+        if ((lstat(addr, &st) == 0) && S_ISSOCK(st.st_mode))
+            unlink(addr);
+        if(
+          (listenFd < 0)
+          || (bind(
+            listenFd,
+            (struct sockaddr *)&sockAddr,
+            sizeof(sockAddr)) < 0)
+        )
+            return false;
+        unixPath = strdup(addr);
+    } else {
+        struct sockaddr_in sockAddr;
+        memset(&sockAddr, 0, sizeof(sockAddr));
+        sockAddr.sin_family = AF_INET;
+        sockAddr.sin_port = htons(atoi(addr));
+        sockAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        int reuse = 1;
+        if (listenFd >= 0)
+            setsockopt(
+              listenFd,
+              SOL_SOCKET,
+              SO_REUSEADDR,
+              &reuse,
+              sizeof(reuse));
+        if(
+          (listenFd < 0)
+          || (bind(
+            listenFd,
+            (struct sockaddr *)&sockAddr,
+            sizeof(sockAddr)) < 0)
+        )
+            return false;
+    }
+    if (listen(listenFd, 8) < 0)
+        return false;
+    return pthread_create(&server, NULL, serve, NULL) == 0;
+}
+
+void MetricsClose() {
+    if (listenFd < 0)
+        return;
+    shutdown(listenFd, SHUT_RDWR);
+    pthread_join(server, NULL);
+    close(listenFd);
+    listenFd = -1;
+    if (unixPath) {
+        unlink(unixPath);
+        free(unixPath);
+        unixPath = NULL;
+    }
+}
@@ -0,0 +1,60 @@
+/*
+ * Scan Bluetooth's for Info
+ * Copyright (C) 2025 Hermawan <minghermawan@yahoo.com>
+ * https://www.linkedin.com/in/hermawan-ho-a3801194/
+ * GNU General Public License (GPL) v3.0
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+// Histograms are log-linear over microseconds: 16 linear sub-buckets per
+// power of two up to 2^35 us (about 9.5 hours), so any recorded time is
+// kept to within 1/16 of its value.
+#define HIST_SUB_BITS 4
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_MAX_EXP 35
+#define HIST_BUCKETS ((HIST_MAX_EXP - HIST_SUB_BITS + 2) * HIST_SUB)
+
+enum MetricCounter {
+    COUNT_FOUND,
+    COUNT_SKIPPED,
+    COUNT_INTERROGATIONS,
+    COUNT_INTERROGATIONS_OK,
+    COUNT_CONN_FAILS,
+    COUNT_NAME_FAILS,
+    COUNT_VER_FAILS,
+    COUNT_CYCLES,
+    COUNT_MAX
+};
+
+enum MetricGauge {
+    GAUGE_KNOWN_DEVICES,
+    GAUGE_CYCLE_FOUND,
+    GAUGE_MAX
+};
+
+enum MetricHist {
+    HIST_CYCLE,
+    HIST_INQUIRY,
+    HIST_CONN,
+    HIST_NAME,
+    HIST_VER,
+    HIST_INTERROGATION,
+    HIST_OUI,
+    HIST_DB_UPSERT,
+    HIST_DB_SIGHTING,
+    HIST_DB_COMMIT,
+    HIST_DB_PRUNE,
+    HIST_DB_LOAD,
+    HIST_MAX
+};
+
+uint64_t MetricNow();
+void MetricAdd(enum MetricCounter counter, uint64_t val);
+void MetricSet(enum MetricGauge gauge, int64_t val);
+void MetricRecord(enum MetricHist hist, uint64_t us);
+void MetricSince(enum MetricHist hist, uint64_t startUs);
+void MetricsWrite(FILE *out);
+bool MetricsServe(const char *addr);
+void MetricsClose();
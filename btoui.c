@@ -0,0 +1,235 @@
+/*
+ * Scan Bluetooth's for Info
+ * Copyright (C) 2025 Hermawan <minghermawan@yahoo.com>
+ * https://www.linkedin.com/in/hermawan-ho-a3801194/
+ * GNU General Public License (GPL) v3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "btoui.h"
+
+const int OUI_CHECK_INTERVAL = 10;
+
+static char *ouiFilename = NULL;
+static char *names = NULL;
+static size_t fileLen = 0;
+static time_t mtime = 0;
+static time_t checkedAt = 0;
+static struct OUIEntry *entries = NULL;
+static uint32_t count = 0;
+
+static int hexVal(char c) {
+    if ((c >= '0') && (c <= '9'))
+        return c - '0';
+    if ((c >= 'A') && (c <= 'F'))
+        return c - 'A' + 10;
+    if ((c >= 'a') && (c <= 'f'))
+        return c - 'a' + 10;
+    return -1;
+}
+
+static int cmpEntry(const void *a, const void *b) {
+    uint32_t ouiA = ((const struct OUIEntry *)a)->oui;
+    uint32_t ouiB = ((const struct OUIEntry *)b)->oui;
+    return (ouiA > ouiB) - (ouiA < ouiB);
+}
+
+// Parse a "XXXXXX     (base 16)\t\tVendor" line of the IEEE oui.txt.
+static bool parseLine(const char *base,
+                      const char *line,
+                      const char *end,
+                      struct OUIEntry *entry) {
+    if (end - line < 6)
+        return false;
+    uint32_t oui = 0;
+    for (int n = 0; n < 6; n++) {
+        int val = hexVal(line[n]);
+        if (val < 0)
+            return false;
+        oui = (oui << 4) | val;
+    }
+    const char *pos = line + 6;
+    while ((pos < end) && ((*pos == ' ') || (*pos == '\t')))
+        pos++;
+    if ((end - pos < 9) || (memcmp(pos, "(base 16)", 9) != 0))
+        return false;
+    pos += 9;
+    while ((pos < end) && ((*pos == ' ') || (*pos == '\t')))
+        pos++;
+    while(
+      (end > pos)
+      && ((end[-1] == '\r') || (end[-1] == ' ') || (end[-1] == '\t'))
+    )
+        end--;
+    if (end == pos)
+        return false;
+    entry->oui = oui;
+    entry->nameOff = pos - base;
+    entry->nameLen = end - pos;
+    return true;
+}
+
+// Read all of fd, which may be shorter or longer than its size at open.
+static char *readFile(int fd, size_t cap, size_t *len) {
+    size_t used = 0;
+    char *buf = malloc(cap);
+    while (buf) {
+        if (used == cap) {
+            cap *= 2;
+            char *grown = realloc(buf, cap);
+            if (!grown) {
+                free(buf);
+                return NULL;
+            }
+            buf = grown;
+        }
+        ssize_t got = read(fd, buf + used, cap - used);
+        if ((got < 0) && (errno == EINTR))
+            continue;
+        if (got < 0) {
+            free(buf);
+            return NULL;
+        }
+        if (got == 0)
+            break;
+        used += got;
+    }
+    *len = used;
+    return buf;
+}
+
+// Read the registry and build a sorted index with its own copy of the
+// names, so the file can be rewritten under it at any time. On failure
+// the index in use stays untouched and errno says why.
+static bool loadOUI() {
+    int fd = open(ouiFilename, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return false;
+    }
+    size_t len;
+    char *buf = readFile(fd, st.st_size + 1, &len);
+    close(fd);
+    if (!buf)
+        return false;
+
+    uint32_t cap = 1024;
+    uint32_t cnt = 0;
+    size_t namesLen = 0;
+    struct OUIEntry *newEntries = malloc(cap * sizeof(struct OUIEntry));
+    const char *line = buf;
+    const char *bufEnd = buf + len;
+    while (newEntries && (line < bufEnd)) {
+        const char *end = memchr(line, '\n', bufEnd - line);
+        if (!end)
+            end = bufEnd;
+        if (cnt == cap) {
+            cap *= 2;
+            struct OUIEntry *grown = realloc(
+              newEntries,
+              cap * sizeof(struct OUIEntry));
+            if (!grown) {
+                free(newEntries);
+                newEntries = NULL;
+                break;
+            }
+            newEntries = grown;
+        }
+        if (parseLine(buf, line, end, &newEntries[cnt])) {
+            namesLen += newEntries[cnt].nameLen;
+            cnt += 1;
+        }
+        line = end + 1;
+    }
+    char *newNames = newEntries && cnt ? malloc(namesLen) : NULL;
+    if (!newNames) {
+        errno = newEntries && !cnt ? EINVAL : ENOMEM;
+        free(newEntries);
+        free(buf);
+        return false;
+    }
+    size_t namePos = 0;
+    for (uint32_t n = 0; n < cnt; n++) {
+        memcpy(
+          newNames + namePos,
+          buf + newEntries[n].nameOff,
+          newEntries[n].nameLen);
+        newEntries[n].nameOff = namePos;
+        namePos += newEntries[n].nameLen;
+    }
+    free(buf);
+    qsort(newEntries, cnt, sizeof(struct OUIEntry), cmpEntry);
+
+    free(names);
+    free(entries);
+    names = newNames;
+    fileLen = st.st_size;
+    mtime = st.st_mtime;
+    entries = newEntries;
+    count = cnt;
+    return true;
+}
+
+// Load the IEEE MA-L registry (oui.txt). It is checked for changes
+// every few seconds and reloaded when it is replaced.
+bool OpenOUI(const char *filename) {
+    ouiFilename = strdup(filename);
+    if (!ouiFilename) {
+        perror("Can't allocate memory");
+        exit(1);
+    }
+    checkedAt = time(NULL);
+    return loadOUI();
+}
+
+// Find the vendor of a 24-bit OUI. The name is not NUL-terminated and
+// stays valid until the next FindOUI() call.
+const char *FindOUI(uint32_t oui, int *len) {
+    if (!ouiFilename)
+        return NULL;
+    time_t now = time(NULL);
+    if (now - checkedAt >= OUI_CHECK_INTERVAL) {
+        checkedAt = now;
+        struct stat st;
+        if(
+          (stat(ouiFilename, &st) == 0)
+          && ((st.st_mtime != mtime) || ((size_t)st.st_size != fileLen))
+        )
+            loadOUI();
+    }
+    uint32_t lo = 0;
+    uint32_t hi = count;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (entries[mid].oui < oui)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if ((lo == count) || (entries[lo].oui != oui))
+        return NULL;
+    *len = entries[lo].nameLen;
+    return names + entries[lo].nameOff;
+}
+
+void CloseOUI() {
+    free(names);
+    free(entries);
+    free(ouiFilename);
+    names = NULL;
+    fileLen = 0;
+    entries = NULL;
+    count = 0;
+    ouiFilename = NULL;
+}
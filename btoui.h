@@ -0,0 +1,19 @@
+/*
+ * Scan Bluetooth's for Info
+ * Copyright (C) 2025 Hermawan <minghermawan@yahoo.com>
+ * https://www.linkedin.com/in/hermawan-ho-a3801194/
+ * GNU General Public License (GPL) v3.0
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+// One IEEE MA-L assignment; the name is a slice of the loaded names.
+struct OUIEntry {
+    uint32_t oui;
+    uint32_t nameOff;
+    uint32_t nameLen;
+};
+
+bool OpenOUI(const char *filename);
+const char *FindOUI(uint32_t oui, int *len);
+void CloseOUI();
@@ -0,0 +1,197 @@
+/*
+ * Scan Bluetooth's for Info
+ * Copyright (C) 2025 Hermawan <minghermawan@yahoo.com>
+ * https://www.linkedin.com/in/hermawan-ho-a3801194/
+ * GNU General Public License (GPL) v3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/hci.h>
+#include <bluetooth/hci_lib.h>
+#include "btinfo.h"
+#include "btcache.h"
+#include "btmetrics.h"
+#include "bttrace.h"
+#include "hciasync.h"
+#include "btpool.h"
+
+const int INQUIRY_LEN = 8;
+
+static struct PoolJob *newJob(enum PoolEvt evt) {
+    struct PoolJob *job = calloc(1, sizeof(struct PoolJob));
+    if (!job) {
+        perror("Can't allocate memory");
+        exit(1);
+    }
+    job->evt = evt;
+    return job;
+}
+
+static void pushEvt(struct BTPool *pool, struct PoolJob *job) {
+    job->next = NULL;
+    if (pool->evtTail)
+        pool->evtTail->next = job;
+    else
+        pool->evtHead = job;
+    pool->evtTail = job;
+}
+
+static void addFound(struct BTPool *pool,
+                     inquiry_info *inquiryInfo,
+                     int8_t rssi,
+                     const uint8_t *eir) {
+    // Controllers may report a device more than once per inquiry.
+    for (int n = 0; n < pool->foundCnt; n++) {
+        if (bacmp(&pool->found[n], &inquiryInfo->bdaddr) == 0)
+            return;
+    }
+    if (pool->foundCnt == pool->foundCap) {
+        pool->foundCap = pool->foundCap ? pool->foundCap * 2 : 64;
+        bdaddr_t *newFound = realloc(
+          pool->found,
+          pool->foundCap * sizeof(bdaddr_t));
+        if (!newFound) {
+            printf("Memory reallocation failed.\n");
+            exit(1);
+        }
+        pool->found = newFound;
+    }
+    bacpy(&pool->found[pool->foundCnt], &inquiryInfo->bdaddr);
+    pool->foundCnt += 1;
+    MetricAdd(COUNT_FOUND, 1);
+
+    struct PoolJob *job = newJob(POOL_FOUND);
+    job->inquiryInfo = *inquiryInfo;
+    job->inquiryInfo.clock_offset |= htobs(0x8000);
+    job->seenAt = time(NULL);
+    job->rssi = rssi;
+    ba2str(&inquiryInfo->bdaddr, job->addr);
+    if (eir)
+        getEIR(eir, HCI_MAX_EIR_LENGTH, &job->eir);
+    else
+        job->eir.txPower = TX_POWER_UNKNOWN;
+    pushEvt(pool, job);
+}
+
+static void endCycle(struct BTPool *pool) {
+    struct PoolJob *job = newJob(POOL_CYCLE_END);
+    job->foundCnt = pool->foundCnt;
+    pushEvt(pool, job);
+    pool->foundCnt = 0;
+}
+
+static void onOpDone(struct HCIOp *op, void *arg) {
+    struct BTPool *pool = arg;
+    struct PoolJob *job = op->ctx;
+    job->evt = POOL_DONE;
+    job->info = op->info;
+    job->took = op->took;
+    pool->pendingCnt -= 1;
+    IndexDelete(&pool->pending, &job->inquiryInfo.bdaddr);
+    pushEvt(pool, job);
+}
+
+static void onFound(inquiry_info *inquiryInfo,
+                    int8_t rssi,
+                    const uint8_t *eir,
+                    void *arg) {
+    addFound(arg, inquiryInfo, rssi, eir);
+}
+
+static void onInquiryDone(void *arg) {
+    struct BTPool *pool = arg;
+    MetricSince(HIST_INQUIRY, pool->inquiryAt);
+    TraceTrack("inquiry", "inquiry", 0, pool->inquiryAt, MetricNow());
+    if (!pool->isStreaming) {
+        pool->isInquiring = false;
+        pool->isInquiryDone = true;
+        return;
+    }
+    endCycle(pool);
+    pool->inquiryAt = MetricNow();
+    EngineInquire(pool->engine, INQUIRY_LEN);
+}
+
+struct BTPool *PoolOpen(struct HCISession *session,
+                        int maxLinks,
+                        bool isStreaming) {
+    struct BTPool *pool = calloc(1, sizeof(struct BTPool));
+    if (!pool) {
+        perror("Can't allocate memory");
+        exit(1);
+    }
+    pool->session = session;
+    pool->isStreaming = isStreaming;
+    pool->engine = EngineOpen(session, maxLinks, onOpDone, pool);
+    IndexInit(&pool->pending, 0);
+    pool->engine->onFound = onFound;
+    pool->engine->onInquiryDone = onInquiryDone;
+    if (isStreaming) {
+        pool->inquiryAt = MetricNow();
+        EngineInquire(pool->engine, INQUIRY_LEN);
+    }
+    return pool;
+}
+
+// Interrogate a device from a POOL_FOUND job; it comes back from
+// PoolNext() as POOL_DONE.
+void PoolSubmit(struct BTPool *pool, struct PoolJob *job) {
+    pool->pendingCnt += 1;
+    IndexPut(&pool->pending, &job->inquiryInfo.bdaddr, 0);
+    EngineSubmit(pool->engine, &job->inquiryInfo, &job->limit, job);
+}
+
+// In streaming mode a device can be heard again while its interrogation
+// from an earlier cycle is still queued or running; it must not be
+// submitted twice.
+bool PoolIsPending(struct BTPool *pool, const bdaddr_t *btAddr) {
+    return IndexFind(&pool->pending, btAddr) >= 0;
+}
+
+// Return the next pool event, driving inquiry and the HCI engine until
+// one is ready. The caller owns the returned job and must free() it.
+// Returns NULL when a signal interrupts the wait.
+//
+// Both modes inquire on the engine socket, so devices come with RSSI and
+// Extended Inquiry Response data. Without streaming, the devices an
+// inquiry finds are held back until it ends, so paging never competes
+// with it, and the cycle ends once every submitted device is done. In
+// streaming mode inquiries run back to back, devices are reported as
+// soon as they answer and a cycle ends with each Inquiry Complete event.
+struct PoolJob *PoolNext(struct BTPool *pool) {
+    while (!pool->evtHead || pool->isInquiring) {
+        if(
+          pool->isStreaming
+          || pool->isInquiring
+          || (pool->isInquiryDone && pool->pendingCnt)
+        ) {
+            uint64_t pollAt = MetricNow();
+            int ret = EnginePoll(pool->engine, -1);
+            TraceSince("engine_poll", pollAt);
+            if (ret < 0)
+                return NULL;
+        } else if (!pool->isInquiryDone) {
+            pool->isInquiring = true;
+            pool->inquiryAt = MetricNow();
+            EngineInquire(pool->engine, INQUIRY_LEN);
+        } else {
+            endCycle(pool);
+            pool->isInquiryDone = false;
+        }
+    }
+    struct PoolJob *job = pool->evtHead;
+    pool->evtHead = job->next;
+    if (!pool->evtHead)
+        pool->evtTail = NULL;
+    job->next = NULL;
+    return job;
+}
+
+void PoolClose(struct BTPool *pool) {
+    EngineClose(pool->engine);
+    IndexFree(&pool->pending);
+    free(pool->found);
+    free(pool);
+}
@@ -0,0 +1,62 @@
+/*
+ * Scan Bluetooth's for Info
+ * Copyright (C) 2025 Hermawan <minghermawan@yahoo.com>
+ * https://www.linkedin.com/in/hermawan-ho-a3801194/
+ * GNU General Public License (GPL) v3.0
+ */
+#include <stdbool.h>
+#include <time.h>
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/hci.h>
+
+// Include btinfo.h, btcache.h and hciasync.h before this header.
+
+// Controllers don't report how many links they can hold at once (acl_pkts
+// counts ACL data buffers), so default to the 7 active slaves a BR/EDR
+// piconet allows; -j overrides it.
+#define MAX_ACL_LINKS 7
+
+enum PoolEvt {
+    POOL_FOUND,
+    POOL_DONE,
+    POOL_CYCLE_END
+};
+
+struct PoolJob {
+    enum PoolEvt evt;
+    inquiry_info inquiryInfo;
+    time_t seenAt;
+    int8_t rssi;
+    char addr[19];
+    struct EIRStruct eir;
+    struct HCIStageMs limit;
+    struct HCIStageMs took;
+    struct InfoStruct info;
+    int foundCnt;
+    struct PoolJob *next;
+};
+
+struct BTPool {
+    struct HCISession *session;
+    bool isStreaming;
+    bool isInquiring;
+    bool isInquiryDone;
+    uint64_t inquiryAt;
+    struct HCIEngine *engine;
+    struct PoolJob *evtHead;
+    struct PoolJob *evtTail;
+    int pendingCnt;
+    // 1 for addresses queued or being interrogated, 0 once done.
+    struct BTIndex pending;
+    bdaddr_t *found;
+    int foundCnt;
+    int foundCap;
+};
+
+struct BTPool *PoolOpen(struct HCISession *session,
+                        int maxLinks,
+                        bool isStreaming);
+void PoolSubmit(struct BTPool *pool, struct PoolJob *job);
+bool PoolIsPending(struct BTPool *pool, const bdaddr_t *btAddr);
+struct PoolJob *PoolNext(struct BTPool *pool);
+void PoolClose(struct BTPool *pool);
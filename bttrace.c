@@ -0,0 +1,243 @@
+/*
+ * Scan Bluetooth's for Info
+ * Copyright (C) 2025 Hermawan <minghermawan@yahoo.com>
+ * https://www.linkedin.com/in/hermawan-ho-a3801194/
+ * GNU General Public License (GPL) v3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "btmetrics.h"
+#include "bttrace.h"
+
+static FILE *traceFile = NULL;
+static bool isTracing = false;
+static pthread_mutex_t ringsLock = PTHREAD_MUTEX_INITIALIZER;
+static struct TraceRing *rings = NULL;
+static __thread struct TraceRing *ring = NULL;
+
+// Tracing stays off unless this succeeds; the trace is written to
+// filename by TraceClose().
+bool TraceOpen(const char *filename) {
+    traceFile = fopen(filename, "w");
+    if (!traceFile)
+        return false;
+    isTracing = true;
+    return true;
+}
+
+bool IsTracing() {
+    return isTracing;
+}
+
+// Each thread gets its ring on its first span, so only the owner writes
+// to it and recording takes no lock.
+static struct TraceRing *getRing() {
+    if (ring)
+        return ring;
+    ring = calloc(1, sizeof(struct TraceRing));
+    if (!ring) {
+        perror("Can't allocate memory");
+        exit(1);
+    }
+    ring->tid = syscall(SYS_gettid);
+    pthread_mutex_lock(&ringsLock);
+    ring->next = rings;
+    rings = ring;
+    pthread_mutex_unlock(&ringsLock);
+    return ring;
+}
+
+void TraceThread(const char *name) {
+    if (!isTracing)
+        return;
+    getRing()->threadName = name;
+}
+
+static void addSpan(const char *cat,
+                    const char *name,
+                    uint64_t id,
+                    uint64_t startUs,
+                    uint64_t endUs) {
+    struct TraceRing *r = getRing();
+    struct TraceSpan *span = &r->spans[r->spanCnt % TRACE_RING_SPANS];
+    span->cat = cat;
+    span->name = name;
+    span->id = id;
+    span->startUs = startUs;
+    span->endUs = endUs;
+    r->spanCnt += 1;
+}
+
+// Record a span from startUs until now on the calling thread.
+void TraceSince(const char *name, uint64_t startUs) {
+    if (!isTracing)
+        return;
+    addSpan(NULL, name, 0, startUs, MetricNow());
+}
+
+// Record a span on the cat and id track. Spans of one track must nest.
+void TraceTrack(const char *cat,
+                const char *name,
+                uint64_t id,
+                uint64_t startUs,
+                uint64_t endUs) {
+    if (!isTracing)
+        return;
+    addSpan(cat, name, id, startUs, endUs);
+}
+
+// A span on a track, with the thread that recorded it.
+struct TrackSpan {
+    struct TraceSpan *span;
+    int tid;
+};
+
+static int cmpTrackSpan(const void *a, const void *b) {
+    const struct TraceSpan *span1 = ((const struct TrackSpan *)a)->span;
+    const struct TraceSpan *span2 = ((const struct TrackSpan *)b)->span;
+    int cmp = strcmp(span1->cat, span2->cat);
+    if (cmp)
+        return cmp;
+    if (span1->id != span2->id)
+        return span1->id < span2->id ? -1 : 1;
+    if (span1->startUs != span2->startUs)
+        return span1->startUs < span2->startUs ? -1 : 1;
+    // Of spans that start together, the longest encloses the others.
+    if (span1->endUs != span2->endUs)
+        return span1->endUs > span2->endUs ? -1 : 1;
+    return 0;
+}
+
+static void writeTrackEvent(FILE *out,
+                            int pid,
+                            struct TrackSpan *trackSpan,
+                            char phase) {
+    struct TraceSpan *span = trackSpan->span;
+    fprintf(
+      out,
+      ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\","
+      "\"id\":\"0x%" PRIx64 "\",\"ts\":%" PRIu64 ",\"pid\":%d,\"tid\":%d}",
+      span->name,
+      span->cat,
+      phase,
+      span->id,
+      phase == 'b' ? span->startUs : span->endUs,
+      pid,
+      trackSpan->tid);
+}
+
+// Viewers pair the begin and end events of a track as a stack, so write
+// each track in nesting order; spans that end at the same time as an
+// enclosing one would otherwise close it early.
+static void writeTracks(FILE *out,
+                        int pid,
+                        struct TrackSpan *trackSpans,
+                        size_t cnt) {
+    if (!cnt)
+        return;
+    qsort(trackSpans, cnt, sizeof(struct TrackSpan), cmpTrackSpan);
+    struct TrackSpan **open = malloc(cnt * sizeof(struct TrackSpan *));
+    if (!open) {
+        perror("Can't allocate memory");
+        exit(1);
+    }
+    size_t openCnt = 0;
+    for (size_t n = 0; n <= cnt; n++) {
+        struct TraceSpan *span = n < cnt ? trackSpans[n].span : NULL;
+        while (openCnt > 0) {
+            struct TraceSpan *top = open[openCnt - 1]->span;
+            if(
+              span
+              && (strcmp(top->cat, span->cat) == 0)
+              && (top->id == span->id)
+              && (top->endUs > span->startUs)
+            )
+                break;
+            openCnt -= 1;
+            writeTrackEvent(out, pid, open[openCnt], 'e');
+        }
+        if (!span)
+            break;
+        writeTrackEvent(out, pid, &trackSpans[n], 'b');
+        open[openCnt++] = &trackSpans[n];
+    }
+    free(open);
+}
+
+// Write every ring as Chrome trace JSON, which chrome://tracing and the
+// Perfetto UI open, then stop tracing. Call it once the traced threads
+// are done.
+void TraceClose() {
+    if (!traceFile)
+        return;
+    isTracing = false;
+    int pid = getpid();
+    fprintf(
+      traceFile,
+      "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+      "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+      "\"args\":{\"name\":\"scanbtforinfo\"}}",
+      pid);
+    pthread_mutex_lock(&ringsLock);
+    size_t trackCnt = 0;
+    for (struct TraceRing *r = rings; r; r = r->next)
+        trackCnt += r->spanCnt < TRACE_RING_SPANS
+          ? r->spanCnt
+          : TRACE_RING_SPANS;
+    struct TrackSpan *trackSpans = malloc(
+      (trackCnt ? trackCnt : 1) * sizeof(struct TrackSpan));
+    if (!trackSpans) {
+        perror("Can't allocate memory");
+        exit(1);
+    }
+    trackCnt = 0;
+    for (struct TraceRing *r = rings; r; r = r->next) {
+        if (r->threadName)
+            fprintf(
+              traceFile,
+              ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,"
+              "\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+              pid,
+              r->tid,
+              r->threadName);
+        uint64_t first = r->spanCnt > TRACE_RING_SPANS
+          ? r->spanCnt - TRACE_RING_SPANS
+          : 0;
+        for (uint64_t n = first; n < r->spanCnt; n++) {
+            struct TraceSpan *span = &r->spans[n % TRACE_RING_SPANS];
+            if (span->cat) {
+                trackSpans[trackCnt].span = span;
+                trackSpans[trackCnt].tid = r->tid;
+                trackCnt += 1;
+                continue;
+            }
+            fprintf(
+              traceFile,
+              ",\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%" PRIu64
+              ",\"dur\":%" PRIu64 ",\"pid\":%d,\"tid\":%d}",
+              span->name,
+              span->startUs,
+              span->endUs - span->startUs,
+              pid,
+              r->tid);
+        }
+    }
+    writeTracks(traceFile, pid, trackSpans, trackCnt);
+    free(trackSpans);
+    while (rings) {
+        struct TraceRing *r = rings;
+        rings = r->next;
+        free(r);
+    }
+    pthread_mutex_unlock(&ringsLock);
+    fprintf(traceFile, "\n]}\n");
+    if (fclose(traceFile) != 0)
+        perror("Can't write trace");
+    traceFile = NULL;
+    ring = NULL;
+}
@@ -0,0 +1,43 @@
+/*
+ * Scan Bluetooth's for Info
+ * Copyright (C) 2025 Hermawan <minghermawan@yahoo.com>
+ * https://www.linkedin.com/in/hermawan-ho-a3801194/
+ * GNU General Public License (GPL) v3.0
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+// Spans are kept per thread in a ring of the last TRACE_RING_SPANS, so a
+// long run keeps its most recent history. Times are microseconds of
+// CLOCK_MONOTONIC, as returned by MetricNow().
+#define TRACE_RING_SPANS (1 << 16)
+
+// A span on the thread that recorded it when cat is NULL, else on the
+// track shared by every span of the same cat and id, for work that
+// overlaps other work on the thread.
+struct TraceSpan {
+    const char *cat;
+    const char *name;
+    uint64_t id;
+    uint64_t startUs;
+    uint64_t endUs;
+};
+
+struct TraceRing {
+    int tid;
+    const char *threadName;
+    uint64_t spanCnt;
+    struct TraceRing *next;
+    struct TraceSpan spans[TRACE_RING_SPANS];
+};
+
+bool TraceOpen(const char *filename);
+bool IsTracing();
+void TraceThread(const char *name);
+void TraceSince(const char *name, uint64_t startUs);
+void TraceTrack(const char *cat,
+                const char *name,
+                uint64_t id,
+                uint64_t startUs,
+                uint64_t endUs);
+void TraceClose();
@@ -1 +1,2 @@
-gcc btinfo.c dbsqlite.c scanbtforinfo.c -lsqlite3 -lbluetooth -o scanbtforinfo;
+gcc btcache.c btcompany.c btinfo.c btlog.c btmetrics.c btoui.c btpool.c bttrace.c dbsqlite.c hciasync.c hcisim.c scanbtforinfo.c -lsqlite3 -lbluetooth -lpthread -lm -o scanbtforinfo;
+gcc -O2 bench.c btcache.c btcompany.c btinfo.c btlog.c btmetrics.c btoui.c btpool.c bttrace.c dbsqlite.c hciasync.c hcisim.c -lsqlite3 -lbluetooth -lpthread -lm -o bench;
@@ -9,56 +9,391 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <sqlite3.h>
 #include "dbsqlite.h"
+#include "btmetrics.h"
+#include "bttrace.h"
 
-const char *FILENAME = "bt.db";
-
-const char* SQL_CREATE_TBL =
-  "CREATE TABLE IF NOT EXISTS bt (" 
-  "address TEXT PRIMARY KEY NOT NULL,"
-  "name TEXT,"
-  "company_name TEXT,"
-  "type TEXT,"
-  "lmp_version INT,"
-  "lmp_sub_version INT,"
-  "manufacture_name TEXT,"
-  "created_at TEXT NOT NULL DEFAULT current_timestamp,"
-  "updated_at TEXT NOT NULL DEFAULT current_timestamp)";
-const char* SQL_INS =
-  "INSERT INTO bt ("
+// One row per observation. seen_at is unix time, address and adapter
+// are 48-bit addresses packed into integers. Old rows are merged into
+// hourly buckets whose samples/attempts/successes keep the counts.
+const char* SQL_CREATE_TBL_SIGHTINGS =
+  "CREATE TABLE IF NOT EXISTS sightings ("
+  "seen_at INTEGER NOT NULL,"
+  "address INTEGER NOT NULL,"
+  "adapter INTEGER NOT NULL,"
+  "rssi INTEGER,"
+  "clock_offset INTEGER,"
+  "samples INTEGER NOT NULL DEFAULT 1,"
+  "attempts INTEGER NOT NULL,"
+  "successes INTEGER NOT NULL,"
+  "PRIMARY KEY (seen_at, address, adapter)) WITHOUT ROWID;"
+  "CREATE INDEX IF NOT EXISTS sightings_address"
+  " ON sightings (address, seen_at);"
+  "CREATE VIEW IF NOT EXISTS sightings_view AS SELECT "
+  "datetime(seen_at, 'unixepoch') AS seen_at,"
+  "printf('%02X:%02X:%02X:%02X:%02X:%02X',"
+  " address >> 40 & 255, address >> 32 & 255, address >> 24 & 255,"
+  " address >> 16 & 255, address >> 8 & 255, address & 255) AS address,"
+  "printf('%02X:%02X:%02X:%02X:%02X:%02X',"
+  " adapter >> 40 & 255, adapter >> 32 & 255, adapter >> 24 & 255,"
+  " adapter >> 16 & 255, adapter >> 8 & 255, adapter & 255) AS adapter,"
+  "rssi,"
+  "clock_offset,"
+  "samples,"
+  "attempts,"
+  "successes"
+  " FROM sightings";
+const char* SQL_INS_SIGHTING =
+  "INSERT INTO sightings ("
+  "seen_at,"
+  "address,"
+  "adapter,"
+  "rssi,"
+  "clock_offset,"
+  "attempts,"
+  "successes)"
+  " VALUES (?, ?, ?, ?, ?, ?, ?)"
+  " ON CONFLICT DO UPDATE SET "
+  "samples=samples + 1,"
+  "attempts=attempts + excluded.attempts,"
+  "successes=successes + excluded.successes";
+// ?1 drops rows older than the retention cutoff, ?2 is the cutoff before
+// which rows are merged into hourly buckets.
+const char* SQL_PRUNE_SIGHTINGS =
+  "DELETE FROM sightings WHERE seen_at < ?1;"
+  "DROP TABLE IF EXISTS temp.sightings_hourly;"
+  "CREATE TEMP TABLE sightings_hourly AS SELECT "
+  "seen_at / 3600 * 3600 AS bucket,"
+  "address,"
+  "adapter,"
+  "CAST(ROUND("
+    "SUM(rssi * samples) * 1.0"
+    " / SUM(CASE WHEN rssi IS NULL THEN 0 ELSE samples END)) AS INTEGER)"
+    " AS rssi,"
+  "clock_offset,"
+  "MAX(seen_at) AS last_seen_at,"
+  "SUM(samples) AS samples,"
+  "SUM(attempts) AS attempts,"
+  "SUM(successes) AS successes"
+  " FROM sightings WHERE seen_at < ?2"
+  " GROUP BY bucket, address, adapter HAVING COUNT(*) > 1;"
+  "DELETE FROM sightings WHERE seen_at < ?2"
+  " AND (seen_at / 3600 * 3600, address, adapter) IN"
+  " (SELECT bucket, address, adapter FROM temp.sightings_hourly);"
+  "INSERT INTO sightings ("
+  "seen_at, address, adapter, rssi, clock_offset,"
+  " samples, attempts, successes)"
+  " SELECT bucket, address, adapter, rssi, clock_offset,"
+  " samples, attempts, successes FROM temp.sightings_hourly;"
+  "DROP TABLE temp.sightings_hourly";
+
+// Names for the numeric ids kept in devices: device_types by the 11-bit
+// major/minor class of a CoD, manufacturers by the 16-bit company id of
+// an LMP version response and companies by the 24-bit OUI of an address.
+const char* SQL_CREATE_TBL_LOOKUPS =
+  "CREATE TABLE IF NOT EXISTS device_types ("
+  "id INTEGER PRIMARY KEY,"
+  "name TEXT NOT NULL);"
+  "CREATE TABLE IF NOT EXISTS manufacturers ("
+  "id INTEGER PRIMARY KEY,"
+  "name TEXT NOT NULL);"
+  "CREATE TABLE IF NOT EXISTS companies ("
+  "oui INTEGER PRIMARY KEY,"
+  "name TEXT NOT NULL);"
+  "CREATE TABLE IF NOT EXISTS lookup_sums ("
+  "lookup INTEGER PRIMARY KEY,"
+  "sum INTEGER NOT NULL)";
+// Only rewrite a name when it differs, so refilling costs no page writes.
+const char* SQL_UPS_LOOKUP[] = {
+  "INSERT INTO device_types (id, name) VALUES (?, ?)"
+  " ON CONFLICT DO UPDATE SET name=excluded.name"
+  " WHERE name IS NOT excluded.name",
+  "INSERT INTO manufacturers (id, name) VALUES (?, ?)"
+  " ON CONFLICT DO UPDATE SET name=excluded.name"
+  " WHERE name IS NOT excluded.name",
+  "INSERT INTO companies (oui, name) VALUES (?, ?)"
+  " ON CONFLICT DO UPDATE SET name=excluded.name"
+  " WHERE name IS NOT excluded.name"
+};
+
+// The first three bytes of an "XX:XX:XX:XX:XX:XX" address as an integer.
+#define SQL_HEX(pos) \
+  "(instr('0123456789ABCDEF', upper(substr(address, " #pos ", 1))) - 1)"
+#define SQL_OUI \
+  "((" SQL_HEX(1) " << 20) | (" SQL_HEX(2) " << 16)" \
+  " | (" SQL_HEX(4) " << 12) | (" SQL_HEX(5) " << 8)" \
+  " | (" SQL_HEX(7) " << 4) | " SQL_HEX(8) ")"
+
+// devices with its ids resolved to names, in the column order GetBTs()
+// reads.
+#define SQL_BT_SELECT \
+  "SELECT " \
+  "devices.address AS address," \
+  "devices.name AS name," \
+  "companies.name AS company_name," \
+  "device_types.name AS type," \
+  "lmp_version," \
+  "lmp_sub_version," \
+  "manufacturers.name AS manufacture_name," \
+  "name_checked_at," \
+  "version_checked_at," \
+  "uuids," \
+  "tx_power," \
+  "cod," \
+  "company_id," \
+  "created_at," \
+  "updated_at" \
+  " FROM devices" \
+  " LEFT JOIN companies ON companies.oui = devices.oui" \
+  " LEFT JOIN device_types ON device_types.id = (cod >> 2) & 2047" \
+  " LEFT JOIN manufacturers ON manufacturers.id = company_id"
+
+// The old bt table's columns, for readers that still use it.
+#define SQL_BT_VIEW \
+  "CREATE VIEW bt AS SELECT " \
+  "address, name, company_name, type, lmp_version, lmp_sub_version," \
+  " manufacture_name, created_at, updated_at, name_checked_at," \
+  " version_checked_at, uuids, tx_power" \
+  " FROM (" SQL_BT_SELECT ");"
+
+// The latest info of every device, with its type, manufacturer and
+// company kept as the raw CoD, company id and OUI.
+#define SQL_CREATE_DEVICES \
+  "CREATE TABLE devices (" \
+  "address TEXT PRIMARY KEY NOT NULL," \
+  "name TEXT," \
+  "cod INTEGER," \
+  "company_id INTEGER," \
+  "oui INTEGER NOT NULL," \
+  "lmp_version INT," \
+  "lmp_sub_version INT," \
+  "name_checked_at INTEGER," \
+  "version_checked_at INTEGER," \
+  "uuids TEXT," \
+  "tx_power INTEGER," \
+  "created_at TEXT NOT NULL DEFAULT current_timestamp," \
+  "updated_at TEXT NOT NULL DEFAULT current_timestamp);"
+
+const char* SQL_CREATE_TBL = SQL_CREATE_DEVICES SQL_BT_VIEW;
+
+// Schema changes applied in order to older bt.db files; the index + 1
+// is stored in PRAGMA user_version once a step has run. New files start
+// at the last step.
+const char* SQL_MIGRATIONS[] = {
+  "ALTER TABLE bt ADD COLUMN name_checked_at INTEGER;"
+  "ALTER TABLE bt ADD COLUMN version_checked_at INTEGER;"
+  "UPDATE bt SET name_checked_at=CAST(strftime('%s', updated_at) AS INTEGER)"
+  " WHERE name <> '';"
+  "UPDATE bt SET "
+  "version_checked_at=CAST(strftime('%s', updated_at) AS INTEGER)"
+  " WHERE lmp_version > 0;",
+  "ALTER TABLE bt ADD COLUMN uuids TEXT;"
+  "ALTER TABLE bt ADD COLUMN tx_power INTEGER;",
+  // Replace the repeated type, manufacturer and company names with the
+  // raw CoD, company id and OUI. Old names map back through the lookup
+  // tables, which CreateTblBT() expects to be filled already; bt stays
+  // as a view for existing readers. Devices whose manufacturer name
+  // didn't map, such as "not assigned", get their version read again.
+  SQL_CREATE_DEVICES
+  "INSERT OR IGNORE INTO companies (oui, name)"
+  " SELECT " SQL_OUI ", MIN(company_name) FROM bt"
+  " WHERE company_name <> '' GROUP BY 1;"
+  "INSERT INTO devices SELECT "
   "address,"
   "name,"
-  "company_name,"
-  "type,"
+  "(SELECT MIN(id) FROM device_types WHERE name = bt.type) << 2,"
+  "(SELECT MIN(id) FROM manufacturers"
+  " WHERE name = bt.manufacture_name),"
+  SQL_OUI ","
   "lmp_version,"
   "lmp_sub_version,"
-  "manufacture_name)"
-  " VALUES (?, ?, ?, ?, ?, ?, ?)";
-const char *SQL_UPD_NAME =
-  "name=:name,";
-const char *SQL_UPD_CO_NAME =
-  "company_name=:coName,";
-const char *SQL_UPD_TYPE =
-  "type=:type,";
-const char *SQL_UPD_LMP_VER =
-  "lmp_version=:lmpVer,";
-const char *SQL_UPD_LMP_SUB_VER =
-  "lmp_sub_version=:lmpSubVer,";
-const char *SQL_UPD_MANUFACTURE_NAME =
-  "manufacture_name=:manufactureName,";
-
-sqlite3 *openDB()
-{
-    sqlite3 *db;
-    int opened = sqlite3_open(FILENAME, &db);
+  "name_checked_at,"
+  "version_checked_at,"
+  "uuids,"
+  "tx_power,"
+  "created_at,"
+  "updated_at"
+  " FROM bt;"
+  "UPDATE devices SET version_checked_at=NULL"
+  " WHERE company_id IS NULL AND lmp_version > 0;"
+  "DROP TABLE bt;"
+  SQL_BT_VIEW,
+  NULL
+};
+
+// True when the incoming row changes a stored value; empty strings and
+// zero versions mean unknown.
+#define SQL_BT_CHANGED \
+  "(excluded.name <> '' AND excluded.name IS NOT devices.name" \
+  " OR excluded.cod IS NOT NULL AND excluded.cod IS NOT devices.cod" \
+  " OR excluded.company_id IS NOT NULL" \
+  " AND excluded.company_id IS NOT devices.company_id" \
+  " OR excluded.lmp_version <> 0" \
+  " AND excluded.lmp_version IS NOT devices.lmp_version" \
+  " OR excluded.lmp_sub_version <> 0" \
+  " AND excluded.lmp_sub_version IS NOT devices.lmp_sub_version" \
+  " OR excluded.uuids <> '' AND excluded.uuids IS NOT devices.uuids" \
+  " OR excluded.tx_power IS NOT NULL" \
+  " AND excluded.tx_power IS NOT devices.tx_power)"
+
+// Insert a new device, or fill in the non-empty fields of a known one.
+// updated_at only moves when a stored value actually changes; the
+// *_checked_at times record when the name was last asked for and the
+// version last read.
+const char* SQL_UPS =
+  "INSERT INTO devices ("
+  "address,"
+  "name,"
+  "cod,"
+  "company_id,"
+  "oui,"
+  "lmp_version,"
+  "lmp_sub_version,"
+  "name_checked_at,"
+  "version_checked_at,"
+  "uuids,"
+  "tx_power)"
+  " VALUES (?, ?, ?, ?, ?, ?, ?, NULLIF(?, 0), NULLIF(?, 0), ?, ?)"
+  " ON CONFLICT(address) DO UPDATE SET "
+  "name=COALESCE(NULLIF(excluded.name, ''), name),"
+  "cod=COALESCE(excluded.cod, cod),"
+  "company_id=COALESCE(excluded.company_id, company_id),"
+  "lmp_version=COALESCE(NULLIF(excluded.lmp_version, 0), lmp_version),"
+  "lmp_sub_version="
+    "COALESCE(NULLIF(excluded.lmp_sub_version, 0), lmp_sub_version),"
+  "name_checked_at="
+    "MAX(IFNULL(excluded.name_checked_at, 0), IFNULL(name_checked_at, 0)),"
+  "version_checked_at=MAX("
+    "IFNULL(excluded.version_checked_at, 0),"
+    " IFNULL(version_checked_at, 0)),"
+  "uuids=COALESCE(NULLIF(excluded.uuids, ''), uuids),"
+  "tx_power=COALESCE(excluded.tx_power, tx_power),"
+  "updated_at=CASE WHEN " SQL_BT_CHANGED
+    " THEN current_timestamp ELSE updated_at END"
+  " WHERE " SQL_BT_CHANGED
+  " OR excluded.name_checked_at > IFNULL(devices.name_checked_at, 0)"
+  " OR excluded.version_checked_at > IFNULL(devices.version_checked_at, 0)";
+
+static sqlite3 *db = NULL;
+static sqlite3_stmt *upsStmt = NULL;
+static sqlite3_stmt *selStmt = NULL;
+static sqlite3_stmt *sightingStmt = NULL;
+static sqlite3_stmt *lookupStmts[3] = {NULL, NULL, NULL};
+static int batchRows = 0;
+static int64_t batchStart = 0;
+static int maxBatchRows = 500;
+static int maxBatchMs = 30000;
+
+static int64_t nowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void execSQL(const char *sql, const char *errTitle) {
+    char *errMsg;
+    int sts = sqlite3_exec(db, sql, NULL, 0, &errMsg);
+    if (sts != SQLITE_OK) {
+        printf(
+          "%s; %s",
+          errTitle,
+          errMsg);
+        sqlite3_free(errMsg);
+        sqlite3_close(db);
+        exit(1);
+    }
+}
+
+void OpenDB(const char *filename) {
+    int opened = sqlite3_open(filename, &db);
     if (opened) {
         printf(
           "Open SQLite database failed; %s",
           sqlite3_errmsg(db));
         exit(1);
     }
-    return db;
+    // WAL lets a background reader run while scan results are written.
+    execSQL("PRAGMA journal_mode=WAL", "Set SQLite journal mode failed");
+    sqlite3_busy_timeout(db, 5000);
+}
+
+// Writes are grouped into one transaction until CommitBatch() is called
+// or the batch reaches maxRows writes or maxMs age (0 for no limit).
+void SetBatchLimits(int maxRows, int maxMs) {
+    maxBatchRows = maxRows;
+    maxBatchMs = maxMs;
+}
+
+void CommitBatch() {
+    if (batchRows == 0)
+        return;
+    uint64_t startUs = MetricNow();
+    execSQL("COMMIT", "Commit SQLite transaction failed");
+    MetricSince(HIST_DB_COMMIT, startUs);
+    TraceSince("db_commit", startUs);
+    batchRows = 0;
+}
+
+static void beginWrite() {
+    if (batchRows > 0)
+        return;
+    execSQL("BEGIN", "Begin SQLite transaction failed");
+    batchStart = nowMs();
+}
+
+static void endWrite() {
+    batchRows += 1;
+    if (
+      ((maxBatchRows > 0) && (batchRows >= maxBatchRows))
+      || ((maxBatchMs > 0) && (nowMs() - batchStart >= maxBatchMs))
+    )
+        CommitBatch();
+}
+
+void CloseDB() {
+    CommitBatch();
+    sqlite3_finalize(upsStmt);
+    upsStmt = NULL;
+    sqlite3_finalize(selStmt);
+    selStmt = NULL;
+    sqlite3_finalize(sightingStmt);
+    sightingStmt = NULL;
+    for (int n = 0; n < 3; n++) {
+        sqlite3_finalize(lookupStmts[n]);
+        lookupStmts[n] = NULL;
+    }
+    sqlite3_close(db);
+    db = NULL;
+}
+
+static sqlite3_stmt *prepare(sqlite3_stmt **stmt,
+                             const char *sql,
+                             const char *errMsg) {
+    if (*stmt)
+        return *stmt;
+    int sts = sqlite3_prepare_v3(
+      db,
+      sql,
+      -1,
+      SQLITE_PREPARE_PERSISTENT,
+      stmt,
+      NULL);
+    if (sts != SQLITE_OK) {
+        printf(
+          "%s; %s",
+          errMsg,
+          sqlite3_errmsg(db));
+        sqlite3_close(db);
+        exit(1);
+    }
+    return *stmt;
+}
+
+static void finish(sqlite3_stmt *stmt) {
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
 }
 void bindTxt(char *val,
              int idx,
@@ -112,220 +447,307 @@ void bindTxtOrNull(char *val,
     }
 }
 
-int getParamIdx(char *param, sqlite3_stmt *stmt, sqlite3 *db) {
-    int idx = sqlite3_bind_parameter_index(stmt, param);
-    if (idx == 0) {
+// The first column of the first row of sql, or 0 when it has no rows.
+static int64_t queryInt(const char *sql, const char *errTitle) {
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
         printf(
-          "Parameter %s not found!",
-          param);
-        sqlite3_finalize(stmt);
+          "%s; %s",
+          errTitle,
+          sqlite3_errmsg(db));
         sqlite3_close(db);
         exit(1);
     }
- }
+    int64_t val = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+        val = sqlite3_column_int64(stmt, 0);
+    sqlite3_finalize(stmt);
+    return val;
+}
 
-void CreateTblBT() {
-    sqlite3 *db = openDB();
-    char *errMsg;
-    int sts = sqlite3_exec(db, SQL_CREATE_TBL, NULL, 0, &errMsg);
-    if (sts != SQLITE_OK) {
-        printf(
-          "Create SQLite table failed; %s",
-          errMsg);
-        sqlite3_free(errMsg);
-        sqlite3_close(db);
-        exit(1);
+static void migrateDB() {
+    int ver = queryInt(
+      "PRAGMA user_version",
+      "Read SQLite schema version failed");
+    for (; SQL_MIGRATIONS[ver]; ver++) {
+        char sql[40];
+        execSQL("BEGIN", "Begin SQLite transaction failed");
+        execSQL(SQL_MIGRATIONS[ver], "Migrate SQLite database failed");
+        sprintf(sql, "PRAGMA user_version=%d", ver + 1);
+        execSQL(sql, "Migrate SQLite database failed");
+        execSQL("COMMIT", "Commit SQLite transaction failed");
     }
-    sqlite3_close(db);
 }
 
-void InstBT(struct BTStruct bt) {
-    sqlite3 *db = openDB();
-    sqlite3_stmt *stmt;
-    int sts;
-    sts = sqlite3_prepare_v2(db, SQL_INS, -1, &stmt, 0);
-    if (sts != SQLITE_OK) {
-        printf(
-          "Insert into SQLite database failed; %s",
-          sqlite3_errmsg(db));
-        sqlite3_close(db);
-        exit(1);
-    }
-    bindTxt(bt.addr, 1, stmt, db);
-    bindTxtOrNull(bt.name, 2, stmt, db);
-    bindTxtOrNull(bt.coName, 3, stmt, db);
-    bindTxtOrNull(bt.type, 4, stmt, db);
-    bindInt(bt.lmpVer, 5, stmt, db);
-    bindInt(bt.lmpSubVer, 6, stmt, db);
-    bindTxtOrNull(bt.manufactureName, 7, stmt, db);
-    sts = sqlite3_step(stmt);
-    if (sts != SQLITE_DONE) {
+void CreateTblLookups() {
+    execSQL(SQL_CREATE_TBL_LOOKUPS, "Create SQLite table failed");
+}
+
+// The checksum stored with a lookup's names, or 0 when it was never
+// filled.
+int64_t GetLookupSum(enum DBLookup lookup) {
+    char sql[60];
+    sprintf(sql, "SELECT sum FROM lookup_sums WHERE lookup=%d", lookup);
+    return queryInt(sql, "Read lookup checksum failed");
+}
+
+void SetLookupSum(enum DBLookup lookup, int64_t sum) {
+    char sql[100];
+    sprintf(
+      sql,
+      "INSERT OR REPLACE INTO lookup_sums (lookup, sum) VALUES (%d, %lld)",
+      lookup,
+      (long long)sum);
+    beginWrite();
+    execSQL(sql, "Save lookup checksum failed");
+    endWrite();
+}
+
+// Store the name of a type, manufacturer or company id.
+void SetLookupName(enum DBLookup lookup, uint32_t id, const char *name) {
+    sqlite3_stmt *stmt = prepare(
+      &lookupStmts[lookup],
+      SQL_UPS_LOOKUP[lookup],
+      "Save lookup into SQLite database failed");
+    beginWrite();
+    sqlite3_bind_int64(stmt, 1, id);
+    bindTxt((char *)name, 2, stmt, db);
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
         printf(
-          "Insert into SQLite database failed; %s",
+          "Save lookup into SQLite database failed; %s",
           sqlite3_errmsg(db));
         sqlite3_finalize(stmt);
         sqlite3_close(db);
         exit(1);
     }
-    sqlite3_finalize(stmt);
-    sqlite3_close(db);
+    finish(stmt);
+    endWrite();
 }
 
-void UpdBT(char addr[19],
-           char name[249],
-           char coName[255],
-           char type[50],
-           uint8_t lmpVer,
-           uint16_t lmpSubVer,
-           char manufactureName[49]) {
-    sqlite3 *db = openDB();
-    sqlite3_stmt *stmt;
-    int sts;
-    char sql[186] = "UPDATE bt SET ";
-    int updColCnt = 0;
-    if (strcmp(name, "") != 0) {
-        strcat(sql, SQL_UPD_NAME);
-        updColCnt += 1;
-    }
-    if (strcmp(coName, "") != 0) {
-        strcat(sql, SQL_UPD_CO_NAME);
-        updColCnt += 1;
-    }
-    if (strcmp(type, "") != 0) {
-        strcat(sql, SQL_UPD_TYPE);
-        updColCnt += 1;
-    }
-    if (lmpVer > 0) {
-        strcat(sql, SQL_UPD_LMP_VER);
-        updColCnt += 1;
-    }
-    if (lmpSubVer > 0) {
-        strcat(sql, SQL_UPD_LMP_SUB_VER);
-        updColCnt += 1;
-    }
-    if (strcmp(manufactureName, "") != 0) {
-        strcat(sql, SQL_UPD_MANUFACTURE_NAME);
-        updColCnt += 1;
-    }
-    if (updColCnt == 0)
+// A new file gets the current schema straight away; older ones are
+// migrated onto it. The lookup tables must exist and be filled already.
+void CreateTblBT() {
+    if (queryInt(
+      "SELECT COUNT(*) FROM sqlite_master WHERE name IN ('bt', 'devices')",
+      "Read SQLite schema failed") > 0
+    ) {
+        migrateDB();
         return;
-    strcat(sql, "updated_at=current_timestamp WHERE address=:addr");
-    sts = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (sts != SQLITE_OK) {
-        printf(
-          "Update SQLite database failed; %s",
-          sqlite3_errmsg(db));
-        sqlite3_close(db);
-        exit(1);
     }
-    int addrIdx = getParamIdx(":addr", stmt, db);
-    int nameIdx = 0;
-    if (strcmp(name, "") != 0)
-        nameIdx = getParamIdx(":name", stmt, db);
-    int coNameIdx = 0;
-    if (strcmp(coName, "") != 0)
-        coNameIdx = getParamIdx(":coName", stmt, db);
-    int typeIdx = 0;
-    if (strcmp(type, "") != 0)
-        typeIdx = getParamIdx(":type", stmt, db);
-    int lmpVerIdx = 0;
-    if (lmpVer > 0)
-        lmpVerIdx = getParamIdx(":lmpVer", stmt, db);
-    int lmpSubVerIdx = 0;
-    if (lmpSubVer > 0)
-        lmpSubVerIdx = getParamIdx(":lmpSubVer", stmt, db);
-    int manufactureNameIdx = 0;
-    if (strcmp(manufactureName, "") != 0) 
-        manufactureNameIdx = getParamIdx(":manufactureName", stmt, db);
-    bindTxt(addr, addrIdx, stmt, db);
-    if (strcmp(name, "") != 0)
-        bindTxt(name, nameIdx, stmt, db);
-    if (strcmp(coName, "") != 0)
-        bindTxt(coName, coNameIdx, stmt, db);
-    if (strcmp(type, "") != 0)
-        bindTxt(type, typeIdx, stmt, db);
-    if (lmpVer > 0)
-        bindInt(lmpVer, lmpVerIdx, stmt, db);
-    if (lmpSubVer > 0)
-        bindInt(lmpSubVer, lmpSubVerIdx, stmt, db);
-    if (strcmp(manufactureName, "") != 0) 
-        bindTxt(manufactureName, manufactureNameIdx, stmt, db);
-    sts = sqlite3_step(stmt);
-    if (sts != SQLITE_DONE) {
+    int ver = 0;
+    while (SQL_MIGRATIONS[ver])
+        ver += 1;
+    char sql[40];
+    execSQL("BEGIN", "Begin SQLite transaction failed");
+    execSQL(SQL_CREATE_TBL, "Create SQLite table failed");
+    sprintf(sql, "PRAGMA user_version=%d", ver);
+    execSQL(sql, "Create SQLite table failed");
+    execSQL("COMMIT", "Commit SQLite transaction failed");
+}
+
+void CreateTblSightings() {
+    execSQL(SQL_CREATE_TBL_SIGHTINGS, "Create SQLite table failed");
+}
+
+void InstSighting(struct SightingStruct *sighting) {
+    sqlite3_stmt *stmt = prepare(
+      &sightingStmt,
+      SQL_INS_SIGHTING,
+      "Insert sighting into SQLite database failed");
+    uint64_t startUs = MetricNow();
+    beginWrite();
+    sqlite3_bind_int64(stmt, 1, sighting->seenAt);
+    sqlite3_bind_int64(stmt, 2, sighting->addr);
+    sqlite3_bind_int64(stmt, 3, sighting->adapter);
+    if (sighting->rssi == 127)
+        sqlite3_bind_null(stmt, 4);
+    else
+        bindInt(sighting->rssi, 4, stmt, db);
+    bindInt(sighting->clockOffset, 5, stmt, db);
+    bindInt(sighting->isAttempted, 6, stmt, db);
+    bindInt(sighting->isSuccess, 7, stmt, db);
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
         printf(
-          "Update SQLite database failed; %s",
+          "Insert sighting into SQLite database failed; %s",
           sqlite3_errmsg(db));
         sqlite3_finalize(stmt);
         sqlite3_close(db);
         exit(1);
     }
-    sqlite3_finalize(stmt);
-    sqlite3_close(db);
+    finish(stmt);
+    MetricSince(HIST_DB_SIGHTING, startUs);
+    TraceSince("db_sighting", startUs);
+    endWrite();
 }
 
-int GetBTsCnt() {
-    const char* sql = "SELECT COUNT(*) FROM bt;";
-    sqlite3* db = openDB();
-    sqlite3_stmt *stmt;
-    int sts = sqlite3_prepare_v3(db, sql, -1, 0, &stmt, NULL);
-    if (sts) {
-        printf(
-          "Get Bluetooth's data count from SQLite database failed; %s",
-          sqlite3_errmsg(db));
+// Drop sightings older than keepDays and merge those older than
+// fullHours into one row per device per hour.
+void PruneSightings(int keepDays, int fullHours) {
+    int64_t now = time(NULL);
+    const char *sql = SQL_PRUNE_SIGHTINGS;
+    uint64_t startUs = MetricNow();
+    beginWrite();
+    while (sql && *sql) {
+        sqlite3_stmt *stmt;
+        if (sqlite3_prepare_v2(db, sql, -1, &stmt, &sql) != SQLITE_OK) {
+            printf(
+              "Prune SQLite sightings failed; %s",
+              sqlite3_errmsg(db));
+            sqlite3_close(db);
+            exit(1);
+        }
+        if (!stmt)
+            continue;
+        int idx = sqlite3_bind_parameter_index(stmt, "?1");
+        if (idx)
+            sqlite3_bind_int64(stmt, idx, now - (int64_t)keepDays * 86400);
+        idx = sqlite3_bind_parameter_index(stmt, "?2");
+        if (idx)
+            sqlite3_bind_int64(stmt, idx, now - (int64_t)fullHours * 3600);
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            printf(
+              "Prune SQLite sightings failed; %s",
+              sqlite3_errmsg(db));
+            sqlite3_finalize(stmt);
+            sqlite3_close(db);
+            exit(1);
+        }
         sqlite3_finalize(stmt);
-        sqlite3_close_v2(db);
-        exit(1);
     }
-    sqlite3_step(stmt);
-    int out = sqlite3_column_int(stmt, 0);
-    sqlite3_finalize(stmt);
-    sqlite3_close_v2(db);
-    return out;
+    MetricSince(HIST_DB_PRUNE, startUs);
+    TraceSince("db_prune", startUs);
+    endWrite();
 }
 
-void GetBTs(struct BTStruct out[]) {
-    const char* sql = "SELECT "
-      "address,"
-      "name,"
-      "company_name,"
-      "type,"
-      "lmp_version,"
-      "lmp_sub_version,"
-      "manufacture_name"
-      " FROM bt;";
-    sqlite3 *db = openDB();
-    sqlite3_stmt *stmt;
-    int sts = sqlite3_prepare_v3(db, sql, -1, 0, &stmt, NULL);
-    if (sts) {
+void UpsertBT(struct BTStruct *bt) {
+    sqlite3_stmt *stmt = prepare(
+      &upsStmt,
+      SQL_UPS,
+      "Save into SQLite database failed");
+    int sts;
+    uint64_t startUs = MetricNow();
+    beginWrite();
+    unsigned int addr[3] = {0, 0, 0};
+    sscanf(bt->addr, "%2x:%2x:%2x", &addr[0], &addr[1], &addr[2]);
+    uint32_t oui = (addr[0] << 16) | (addr[1] << 8) | addr[2];
+    bindTxt(bt->addr, 1, stmt, db);
+    bindTxtOrNull(bt->name, 2, stmt, db);
+    if (bt->cod < 0)
+        sqlite3_bind_null(stmt, 3);
+    else
+        bindInt(bt->cod, 3, stmt, db);
+    if (bt->companyId < 0)
+        sqlite3_bind_null(stmt, 4);
+    else
+        bindInt(bt->companyId, 4, stmt, db);
+    sqlite3_bind_int64(stmt, 5, oui);
+    bindInt(bt->lmpVer, 6, stmt, db);
+    bindInt(bt->lmpSubVer, 7, stmt, db);
+    sqlite3_bind_int64(stmt, 8, bt->nameAt);
+    sqlite3_bind_int64(stmt, 9, bt->verAt);
+    bindTxtOrNull(bt->uuids, 10, stmt, db);
+    // 127 is HCI's "not available" TX power.
+    if (bt->txPower == 127)
+        sqlite3_bind_null(stmt, 11);
+    else
+        sqlite3_bind_int(stmt, 11, bt->txPower);
+    sts = sqlite3_step(stmt);
+    if (sts != SQLITE_DONE) {
         printf(
-          "Get Bluetooth's data from SQLite database failed; %s",
+          "Save into SQLite database failed; %s",
           sqlite3_errmsg(db));
         sqlite3_finalize(stmt);
-        sqlite3_close_v2(db);
+        sqlite3_close(db);
         exit(1);
     }
-    int n = 0;
+    finish(stmt);
+    MetricSince(HIST_DB_UPSERT, startUs);
+    TraceSince("db_upsert", startUs);
+    endWrite();
+    // The company name belongs to the OUI, so it is kept once per OUI.
+    if (bt->coName[0])
+        SetLookupName(LOOKUP_COMPANY, oui, bt->coName);
+}
+
+// Stream every stored device to onRow in one pass. With a filename the
+// rows are read through a private read-only connection, so loading can
+// run on another thread while the main connection keeps writing.
+void GetBTs(const char *filename,
+            void (*onRow)(struct BTStruct *bt, void *arg),
+            void *arg) {
+    const char* sql = SQL_BT_SELECT;
+    sqlite3 *conn = db;
+    sqlite3_stmt *stmt;
+    uint64_t startUs = MetricNow();
+    if (filename) {
+        if (sqlite3_open_v2(
+          filename,
+          &conn,
+          SQLITE_OPEN_READONLY,
+          NULL) != SQLITE_OK
+        ) {
+            printf(
+              "Open SQLite database failed; %s",
+              sqlite3_errmsg(conn));
+            exit(1);
+        }
+        if (sqlite3_prepare_v2(conn, sql, -1, &stmt, NULL) != SQLITE_OK) {
+            printf(
+              "Get Bluetooth's data from SQLite database failed; %s",
+              sqlite3_errmsg(conn));
+            exit(1);
+        }
+    } else {
+        stmt = prepare(
+          &selStmt,
+          sql,
+          "Get Bluetooth's data from SQLite database failed");
+    }
+    struct BTStruct bt;
     while (sqlite3_step(stmt) == SQLITE_ROW) {
         const char* addr = sqlite3_column_text(stmt, 0);
         const char* name = sqlite3_column_text(stmt, 1);
         const char* coName = sqlite3_column_text(stmt, 2);
         const char* type = sqlite3_column_text(stmt, 3);
-        uint8_t lmpVer = sqlite3_column_int(stmt, 4);
-        uint16_t lmpSubVer = sqlite3_column_int(stmt, 5);
         const char* manufactureName = sqlite3_column_text(stmt, 6);
-        strcpy(out[n].addr, addr);
+        memset(&bt, 0, sizeof(bt));
+        snprintf(bt.addr, sizeof(bt.addr), "%s", addr);
         if (name)
-            strcpy(out[n].name, name);
+            snprintf(bt.name, sizeof(bt.name), "%s", name);
         if (coName)
-            strcpy(out[n].coName, coName);
+            snprintf(bt.coName, sizeof(bt.coName), "%s", coName);
         if (type)
-            strcpy(out[n].type, type);
-        out[n].lmpVer = lmpVer;
-        out[n].lmpSubVer = lmpSubVer;
+            snprintf(bt.type, sizeof(bt.type), "%s", type);
+        bt.lmpVer = sqlite3_column_int(stmt, 4);
+        bt.lmpSubVer = sqlite3_column_int(stmt, 5);
         if (manufactureName)
-            strcpy(out[n].manufactureName, manufactureName);
-        n += 1;
+            snprintf(
+              bt.manufactureName,
+              sizeof(bt.manufactureName),
+              "%s",
+              manufactureName);
+        bt.nameAt = sqlite3_column_int64(stmt, 7);
+        bt.verAt = sqlite3_column_int64(stmt, 8);
+        const char* uuids = (const char *)sqlite3_column_text(stmt, 9);
+        if (uuids)
+            snprintf(bt.uuids, sizeof(bt.uuids), "%s", uuids);
+        bt.txPower = 127;
+        if (sqlite3_column_type(stmt, 10) != SQLITE_NULL)
+            bt.txPower = sqlite3_column_int(stmt, 10);
+        bt.cod = -1;
+        if (sqlite3_column_type(stmt, 11) != SQLITE_NULL)
+            bt.cod = sqlite3_column_int(stmt, 11);
+        bt.companyId = -1;
+        if (sqlite3_column_type(stmt, 12) != SQLITE_NULL)
+            bt.companyId = sqlite3_column_int(stmt, 12);
+        onRow(&bt, arg);
     }
-    sqlite3_finalize(stmt);
-    sqlite3_close_v2(db);
+    if (filename) {
+        sqlite3_finalize(stmt);
+        sqlite3_close(conn);
+    } else {
+        finish(stmt);
+    }
+    MetricSince(HIST_DB_LOAD, startUs);
+    TraceSince("db_load", startUs);
 }
@@ -4,6 +4,7 @@
  * https://www.linkedin.com/in/hermawan-ho-a3801194/
  * GNU General Public License (GPL) v3.0
  */
+#include <stdbool.h>
 #include <sqlite3.h>
 
 struct BTStruct {
@@ -13,16 +14,42 @@ struct BTStruct {
     char type[50];
     uint8_t lmpVer;
     uint16_t lmpSubVer;
-    char manufactureName[49];
+    char manufactureName[128];
+    int64_t nameAt;
+    int64_t verAt;
+    char uuids[600];
+    int txPower;
+    int cod;
+    int companyId;
 };
+// Lookup tables that resolve the numeric ids stored per device.
+enum DBLookup {
+    LOOKUP_TYPE,
+    LOOKUP_MANUFACTURER,
+    LOOKUP_COMPANY
+};
+struct SightingStruct {
+    int64_t seenAt;
+    uint64_t addr;
+    uint64_t adapter;
+    int8_t rssi;
+    int clockOffset;
+    bool isAttempted;
+    bool isSuccess;
+};
+void OpenDB(const char *filename);
+void CloseDB();
+void SetBatchLimits(int maxRows, int maxMs);
+void CommitBatch();
+void CreateTblLookups();
+void SetLookupName(enum DBLookup lookup, uint32_t id, const char *name);
+int64_t GetLookupSum(enum DBLookup lookup);
+void SetLookupSum(enum DBLookup lookup, int64_t sum);
 void CreateTblBT();
-void InstBT(struct BTStruct bt);
-void UpdBT(char addr[19],
-           char name[249],
-           char coName[255],
-           char type[50],
-           uint8_t lmpVer,
-           uint16_t lmpSubVer,
-           char manufactureName[49]);
-int GetBTsCnt();
-void GetBTs(struct BTStruct *result);
+void CreateTblSightings();
+void InstSighting(struct SightingStruct *sighting);
+void PruneSightings(int keepDays, int fullHours);
+void UpsertBT(struct BTStruct *bt);
+void GetBTs(const char *filename,
+            void (*onRow)(struct BTStruct *bt, void *arg),
+            void *arg);
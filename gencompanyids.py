@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+#
+# Scan Bluetooth's for Info
+# Copyright (C) 2025 Hermawan <minghermawan@yahoo.com>
+# https://www.linkedin.com/in/hermawan-ho-a3801194/
+# GNU General Public License (GPL) v3.0
+#
+# Generate btcompany.c from a company identifier list in the layout of the
+# Bluetooth SIG's
+# assigned_numbers/company_identifiers/company_identifiers.yaml in
+# https://bitbucket.org/bluetooth-SIG/public
+#
+# Usage: ./gencompanyids.py company_ids.yaml > btcompany.c
+import os
+import re
+import sys
+
+HEADER = """/*
+ * Scan Bluetooth's for Info
+ * Copyright (C) 2025 Hermawan <minghermawan@yahoo.com>
+ * https://www.linkedin.com/in/hermawan-ho-a3801194/
+ * GNU General Public License (GPL) v3.0
+ */
+// Generated by gencompanyids.py from %s; do not edit.
+#include <stddef.h>
+#include "btcompany.h"
+"""
+
+FOOTER = """
+// Company names indexed by the 16-bit id from LMP version responses.
+const char *getManufactureName(int id) {
+    if (id == 0xFFFF)
+        return "internal use";
+    if(
+      (id < 0)
+      || (id >= (int)(sizeof(COMPANY_NAMES) / sizeof(COMPANY_NAMES[0])))
+      || (!COMPANY_NAMES[id])
+    )
+        return "not assigned";
+    return COMPANY_NAMES[id];
+}
+"""
+
+
+def unquote(val):
+    val = val.strip()
+    if val.startswith("'") and val.endswith("'"):
+        return val[1:-1].replace("''", "'")
+    if val.startswith('"') and val.endswith('"'):
+        return val[1:-1].replace('\\"', '"').replace('\\\\', '\\')
+    return val
+
+
+def cString(val):
+    return '"' + val.replace('\\', '\\\\').replace('"', '\\"') + '"'
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit("Usage: %s company_ids.yaml" % sys.argv[0])
+    names = {}
+    value = None
+    with open(sys.argv[1], encoding='utf-8') as file:
+        for line in file:
+            match = re.match(r'\s*-?\s*value:\s*(\S+)', line)
+            if match:
+                value = int(match.group(1), 0)
+                continue
+            match = re.match(r'\s*name:\s*(.+)$', line)
+            if match and value is not None:
+                names[value] = unquote(match.group(1))
+                value = None
+    names.pop(0xFFFF, None)
+
+    out = [HEADER % os.path.basename(sys.argv[1])]
+    out.append("static const char *const COMPANY_NAMES[] = {")
+    for key in sorted(names):
+        out.append("    [0x%04X] = %s," % (key, cString(names[key])))
+    out.append("};")
+    out.append(FOOTER)
+    sys.stdout.write("\n".join(out))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,891 @@
+/*
+ * Scan Bluetooth's for Info
+ * Copyright (C) 2025 Hermawan <minghermawan@yahoo.com>
+ * https://www.linkedin.com/in/hermawan-ho-a3801194/
+ * GNU General Public License (GPL) v3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/hci.h>
+#include <bluetooth/hci_lib.h>
+#include "btinfo.h"
+#include "btcache.h"
+#include "btcompany.h"
+#include "btlog.h"
+#include "btmetrics.h"
+#include "bttrace.h"
+#include "hciasync.h"
+
+const int CONN_TIMEOUT = 25000;
+const int NAME_TIMEOUT = 25000;
+const int VER_TIMEOUT = 20000;
+const int CANCEL_TIMEOUT = 5000;
+const int DISCONN_TIMEOUT = 5000;
+const int INQUIRY_RETRY = 1000;
+// Each op has at most a connection, name and version request and a
+// disconnect waiting for Command Status at once; the inquiry adds one.
+const int CMDS_PER_OP = 4;
+
+static int64_t nowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Only these commands answer with Command Status; the rest answer with
+// Command Complete, which the filter leaves out, so they must never
+// wait in cmds.
+static bool isStatusCmd(uint16_t ogf, uint16_t ocf) {
+    if (ogf != OGF_LINK_CTL)
+        return false;
+    return (ocf == OCF_INQUIRY)
+      || (ocf == OCF_CREATE_CONN)
+      || (ocf == OCF_REMOTE_NAME_REQ)
+      || (ocf == OCF_READ_REMOTE_VERSION)
+      || (ocf == OCF_DISCONNECT);
+}
+
+static void sendCmd(struct HCIEngine *engine,
+                    struct HCIOp *op,
+                    uint16_t ogf,
+                    uint16_t ocf,
+                    uint8_t plen,
+                    void *param) {
+    struct HCISession *session = engine->session;
+    if (session->transport->send(session, ogf, ocf, plen, param) < 0) {
+        perror("Can't send HCI command");
+        exit(1);
+    }
+    if (!isStatusCmd(ogf, ocf))
+        return;
+    if (engine->cmdCnt == engine->cmdCap) {
+        printf("Too many HCI commands waiting for Command Status.\n");
+        exit(1);
+    }
+    int n = (engine->cmdHead + engine->cmdCnt) % engine->cmdCap;
+    engine->cmds[n].opcode = htobs(cmd_opcode_pack(ogf, ocf));
+    engine->cmds[n].op = op;
+    engine->cmdCnt += 1;
+}
+
+// Command Status events carry no address, so match them in send order.
+static struct HCIOp *popCmd(struct HCIEngine *engine, uint16_t opcode) {
+    int size = engine->cmdCap;
+    for (int n1 = 0; n1 < engine->cmdCnt; n1++) {
+        int n2 = (engine->cmdHead + n1) % size;
+        if (engine->cmds[n2].opcode != opcode)
+            continue;
+        struct HCIOp *op = engine->cmds[n2].op;
+        for (int n3 = n1; n3 > 0; n3--) {
+            engine->cmds[(engine->cmdHead + n3) % size] =
+              engine->cmds[(engine->cmdHead + n3 - 1) % size];
+        }
+        engine->cmdHead = (engine->cmdHead + 1) % size;
+        engine->cmdCnt -= 1;
+        return op;
+    }
+    return NULL;
+}
+
+static void forgetCmds(struct HCIEngine *engine, struct HCIOp *op) {
+    int size = engine->cmdCap;
+    for (int n = 0; n < engine->cmdCnt; n++) {
+        if (engine->cmds[(engine->cmdHead + n) % size].op == op)
+            engine->cmds[(engine->cmdHead + n) % size].op = NULL;
+    }
+}
+
+static void recordStage(enum MetricHist hist,
+                        enum MetricCounter fails,
+                        int took) {
+    if (took > 0)
+        MetricRecord(hist, (uint64_t)took * 1000);
+    else if (took < 0)
+        MetricAdd(fails, 1);
+}
+
+static void recordOp(struct HCIOp *op) {
+    MetricAdd(COUNT_INTERROGATIONS, 1);
+    if (op->info.isSuccess)
+        MetricAdd(COUNT_INTERROGATIONS_OK, 1);
+    MetricRecord(
+      HIST_INTERROGATION,
+      (uint64_t)(nowMs() - op->startedAt) * 1000);
+    recordStage(HIST_CONN, COUNT_CONN_FAILS, op->took.conn);
+    recordStage(HIST_NAME, COUNT_NAME_FAILS, op->took.name);
+    recordStage(HIST_VER, COUNT_VER_FAILS, op->took.ver);
+}
+
+// A stage that failed lasted until the op finished.
+static uint64_t stageEndUs(int64_t startMs, int took, int64_t doneMs) {
+    return (uint64_t)(took > 0 ? startMs + took : doneMs) * 1000;
+}
+
+// Every device gets a track named by its address, with the whole
+// interrogation and its stages.
+static void traceOp(struct HCIOp *op) {
+    if (!IsTracing())
+        return;
+    uint64_t id = PackAddr(&op->inquiryInfo.bdaddr);
+    int64_t doneMs = nowMs();
+    TraceTrack(
+      "device",
+      "interrogation",
+      id,
+      (uint64_t)op->startedAt * 1000,
+      (uint64_t)doneMs * 1000);
+    if (op->took.conn)
+        TraceTrack(
+          "device",
+          "conn",
+          id,
+          (uint64_t)op->startedAt * 1000,
+          stageEndUs(op->startedAt, op->took.conn, doneMs));
+    if (op->took.name)
+        TraceTrack(
+          "device",
+          "name",
+          id,
+          (uint64_t)op->queryAt * 1000,
+          stageEndUs(op->queryAt, op->took.name, doneMs));
+    if (op->took.ver)
+        TraceTrack(
+          "device",
+          "ver",
+          id,
+          (uint64_t)op->queryAt * 1000,
+          stageEndUs(op->queryAt, op->took.ver, doneMs));
+}
+
+static void finishOp(struct HCIEngine *engine, struct HCIOp *op) {
+    if (op->isOwnConn && (op->stage == STAGE_QUERYING)) {
+        disconnect_cp cp;
+        cp.handle = htobs(op->handle);
+        cp.reason = HCI_OE_USER_ENDED_CONNECTION;
+        sendCmd(
+          engine,
+          NULL,
+          OGF_LINK_CTL,
+          OCF_DISCONNECT,
+          DISCONNECT_CP_SIZE,
+          &cp);
+        // Every closing link was an op, so there are never more than
+        // maxOps.
+        struct HCILink *link = &engine->closing[engine->closingCnt];
+        link->handle = op->handle;
+        link->deadline = nowMs() + DISCONN_TIMEOUT;
+        engine->closingCnt += 1;
+    }
+    if (op->info.isSuccess)
+        op->info.coName = getCoName(&op->inquiryInfo.bdaddr);
+    op->stage = STAGE_DONE;
+    recordOp(op);
+    traceOp(op);
+    forgetCmds(engine, op);
+
+    struct HCIOp **link = &engine->activeHead;
+    while (*link != op)
+        link = &(*link)->next;
+    *link = op->next;
+    op->next = NULL;
+    engine->activeCnt -= 1;
+    engine->onDone(op, engine->arg);
+    op->next = engine->freeHead;
+    engine->freeHead = op;
+}
+
+// Name and version run in parallel, so wait for whichever pending one
+// has the later limit.
+static void setQueryDeadline(struct HCIOp *op) {
+    int limit = 0;
+    if (op->isNamePending)
+        limit = op->limit.name;
+    if (op->isVerPending && (op->limit.ver > limit))
+        limit = op->limit.ver;
+    op->deadline = op->queryAt + limit;
+}
+
+static void checkQueryDone(struct HCIEngine *engine, struct HCIOp *op) {
+    if (!op->isNamePending && !op->isVerPending)
+        finishOp(engine, op);
+    else
+        setQueryDeadline(op);
+}
+
+static void startQuery(struct HCIEngine *engine, struct HCIOp *op) {
+    op->stage = STAGE_QUERYING;
+    op->info.isSuccess = true;
+    op->queryAt = nowMs();
+
+    remote_name_req_cp nameCp;
+    memset(&nameCp, 0, sizeof(nameCp));
+    bacpy(&nameCp.bdaddr, &op->inquiryInfo.bdaddr);
+    nameCp.pscan_rep_mode = op->inquiryInfo.pscan_rep_mode;
+    nameCp.clock_offset = op->inquiryInfo.clock_offset;
+    sendCmd(
+      engine,
+      op,
+      OGF_LINK_CTL,
+      OCF_REMOTE_NAME_REQ,
+      REMOTE_NAME_REQ_CP_SIZE,
+      &nameCp);
+    op->isNamePending = true;
+
+    read_remote_version_cp verCp;
+    verCp.handle = htobs(op->handle);
+    sendCmd(
+      engine,
+      op,
+      OGF_LINK_CTL,
+      OCF_READ_REMOTE_VERSION,
+      READ_REMOTE_VERSION_CP_SIZE,
+      &verCp);
+    op->isVerPending = true;
+    setQueryDeadline(op);
+}
+
+static void startOp(struct HCIEngine *engine, struct HCIOp *op) {
+    op->next = engine->activeHead;
+    engine->activeHead = op;
+    engine->activeCnt += 1;
+    op->startedAt = nowMs();
+
+    struct HCISession *session = engine->session;
+    if (session->transport->findConn(
+      session,
+      &op->inquiryInfo.bdaddr,
+      &op->handle)
+    ) {
+        op->isOwnConn = false;
+        startQuery(engine, op);
+        return;
+    }
+
+    create_conn_cp cp;
+    memset(&cp, 0, sizeof(cp));
+    bacpy(&cp.bdaddr, &op->inquiryInfo.bdaddr);
+    cp.pkt_type = engine->pktType;
+    cp.pscan_rep_mode = op->inquiryInfo.pscan_rep_mode;
+    cp.clock_offset = op->inquiryInfo.clock_offset;
+    cp.role_switch = 0x01;
+    op->stage = STAGE_CONNECTING;
+    op->isOwnConn = true;
+    op->deadline = op->startedAt + op->limit.conn;
+    sendCmd(
+      engine,
+      op,
+      OGF_LINK_CTL,
+      OCF_CREATE_CONN,
+      CREATE_CONN_CP_SIZE,
+      &cp);
+}
+
+static void dropClosing(struct HCIEngine *engine, int n) {
+    engine->closingCnt -= 1;
+    engine->closing[n] = engine->closing[engine->closingCnt];
+}
+
+static void startWaiting(struct HCIEngine *engine) {
+    while(
+      engine->waitHead
+      && (engine->activeCnt + engine->closingCnt < engine->maxOps)
+    ) {
+        struct HCIOp *op = engine->waitHead;
+        engine->waitHead = op->next;
+        if (!engine->waitHead)
+            engine->waitTail = NULL;
+        startOp(engine, op);
+    }
+}
+
+static struct HCIOp *findByAddr(struct HCIEngine *engine,
+                                bdaddr_t *btAddr,
+                                enum HCIStage stage) {
+    for (struct HCIOp *op = engine->activeHead; op; op = op->next) {
+        if (
+          (op->stage == stage)
+          && (bacmp(&op->inquiryInfo.bdaddr, btAddr) == 0)
+        )
+            return op;
+    }
+    return NULL;
+}
+
+static struct HCIOp *findByHandle(struct HCIEngine *engine,
+                                  uint16_t handle) {
+    for (struct HCIOp *op = engine->activeHead; op; op = op->next) {
+        if ((op->stage == STAGE_QUERYING) && (op->handle == handle))
+            return op;
+    }
+    return NULL;
+}
+
+static void sendInquiry(struct HCIEngine *engine) {
+    // General/Unlimited Inquiry Access Code 0x9E8B33, unlimited responses
+    inquiry_cp cp;
+    cp.lap[0] = 0x33;
+    cp.lap[1] = 0x8b;
+    cp.lap[2] = 0x9e;
+    cp.length = engine->inquiryLen;
+    cp.num_rsp = 0;
+    sendCmd(
+      engine,
+      NULL,
+      OGF_LINK_CTL,
+      OCF_INQUIRY,
+      INQUIRY_CP_SIZE,
+      &cp);
+    engine->isInquiring = true;
+    engine->inquiryRetryAt = 0;
+}
+
+static void onCmdStatus(struct HCIEngine *engine, evt_cmd_status *evt) {
+    struct HCIOp *op = popCmd(engine, evt->opcode);
+    uint16_t opcode = btohs(evt->opcode);
+    if (
+      (opcode == cmd_opcode_pack(OGF_LINK_CTL, OCF_INQUIRY))
+      && (evt->status != 0)
+      && engine->isInquiring
+    ) {
+        LogPrint(
+          LOG_STATUS,
+          "Inquiry failed; status 0x%2.2x\n",
+          evt->status);
+        engine->isInquiring = false;
+        engine->inquiryRetryAt = nowMs() + INQUIRY_RETRY;
+        return;
+    }
+    if (!op || (evt->status == 0))
+        return;
+    if (opcode == cmd_opcode_pack(OGF_LINK_CTL, OCF_CREATE_CONN)) {
+        op->info.isSuccess = false;
+        op->took.conn = -1;
+        finishOp(engine, op);
+    } else if (
+      opcode == cmd_opcode_pack(OGF_LINK_CTL, OCF_REMOTE_NAME_REQ)
+    ) {
+        op->isNamePending = false;
+        op->took.name = -1;
+        checkQueryDone(engine, op);
+    } else if (
+      opcode == cmd_opcode_pack(OGF_LINK_CTL, OCF_READ_REMOTE_VERSION)
+    ) {
+        op->isVerPending = false;
+        op->took.ver = -1;
+        checkQueryDone(engine, op);
+    }
+}
+
+static void onConnComplete(struct HCIEngine *engine,
+                           evt_conn_complete *evt) {
+    struct HCIOp *op = findByAddr(
+      engine,
+      &evt->bdaddr,
+      STAGE_CONNECTING);
+    if (!op)
+        op = findByAddr(engine, &evt->bdaddr, STAGE_CANCELLING);
+    if (!op)
+        return;
+    op->handle = btohs(evt->handle);
+    op->took.conn = -1;
+    if (op->stage == STAGE_CANCELLING) {
+        if (evt->status == 0) {
+            op->stage = STAGE_QUERYING;
+            op->info.isSuccess = false;
+        }
+        finishOp(engine, op);
+        return;
+    }
+    if (evt->status != 0) {
+        op->info.isSuccess = false;
+        finishOp(engine, op);
+        return;
+    }
+    op->took.conn = (int)(nowMs() - op->startedAt);
+    startQuery(engine, op);
+}
+
+static void onNameComplete(struct HCIEngine *engine,
+                           evt_remote_name_req_complete *evt) {
+    struct HCIOp *op = findByAddr(engine, &evt->bdaddr, STAGE_QUERYING);
+    if (!op || !op->isNamePending)
+        return;
+    if (evt->status == 0) {
+        memcpy(op->info.name, evt->name, HCI_MAX_NAME_LENGTH);
+        op->info.name[HCI_MAX_NAME_LENGTH] = '\0';
+        op->took.name = (int)(nowMs() - op->queryAt);
+    } else {
+        op->took.name = -1;
+    }
+    op->isNamePending = false;
+    checkQueryDone(engine, op);
+}
+
+static void onVerComplete(struct HCIEngine *engine,
+                          evt_read_remote_version_complete *evt) {
+    struct HCIOp *op = findByHandle(engine, btohs(evt->handle));
+    if (!op || !op->isVerPending)
+        return;
+    if (evt->status == 0) {
+        op->info.lmpVer = evt->lmp_ver;
+        op->info.lmpSubVer = btohs(evt->lmp_subver);
+        op->info.manufactureId = btohs(evt->manufacturer);
+        op->info.manufactureName = getManufactureName(
+          op->info.manufactureId);
+        op->took.ver = (int)(nowMs() - op->queryAt);
+    } else {
+        op->took.ver = -1;
+    }
+    op->isVerPending = false;
+    checkQueryDone(engine, op);
+}
+
+static void onDisconnComplete(struct HCIEngine *engine,
+                              evt_disconn_complete *evt) {
+    for (int n = 0; n < engine->closingCnt; n++) {
+        if (engine->closing[n].handle == btohs(evt->handle)) {
+            dropClosing(engine, n);
+            return;
+        }
+    }
+}
+
+static void onInquiryResult(struct HCIEngine *engine, uint8_t *ptr) {
+    uint8_t num = ptr[0];
+    inquiry_info *inquiryInfo = (inquiry_info *)(ptr + 1);
+    for (int n = 0; (n < num) && engine->onFound; n++)
+        engine->onFound(inquiryInfo + n, RSSI_UNKNOWN, NULL, engine->arg);
+}
+
+static void onInquiryResultRSSI(struct HCIEngine *engine, uint8_t *ptr) {
+    uint8_t num = ptr[0];
+    inquiry_info_with_rssi *rssiInfo = (inquiry_info_with_rssi *)(ptr + 1);
+    for (int n = 0; (n < num) && engine->onFound; n++) {
+        inquiry_info inquiryInfo;
+        memset(&inquiryInfo, 0, sizeof(inquiryInfo));
+        bacpy(&inquiryInfo.bdaddr, &rssiInfo[n].bdaddr);
+        inquiryInfo.pscan_rep_mode = rssiInfo[n].pscan_rep_mode;
+        inquiryInfo.pscan_period_mode = rssiInfo[n].pscan_period_mode;
+        memcpy(inquiryInfo.dev_class, rssiInfo[n].dev_class, 3);
+        inquiryInfo.clock_offset = rssiInfo[n].clock_offset;
+        engine->onFound(
+          &inquiryInfo,
+          rssiInfo[n].rssi,
+          NULL,
+          engine->arg);
+    }
+}
+
+static void onExtInquiryResult(struct HCIEngine *engine, uint8_t *ptr) {
+    uint8_t num = ptr[0];
+    extended_inquiry_info *extInfo = (extended_inquiry_info *)(ptr + 1);
+    for (int n = 0; (n < num) && engine->onFound; n++) {
+        inquiry_info inquiryInfo;
+        memset(&inquiryInfo, 0, sizeof(inquiryInfo));
+        bacpy(&inquiryInfo.bdaddr, &extInfo[n].bdaddr);
+        inquiryInfo.pscan_rep_mode = extInfo[n].pscan_rep_mode;
+        inquiryInfo.pscan_period_mode = extInfo[n].pscan_period_mode;
+        memcpy(inquiryInfo.dev_class, extInfo[n].dev_class, 3);
+        inquiryInfo.clock_offset = extInfo[n].clock_offset;
+        engine->onFound(
+          &inquiryInfo,
+          extInfo[n].rssi,
+          extInfo[n].data,
+          engine->arg);
+    }
+}
+
+static void onInquiryComplete(struct HCIEngine *engine) {
+    if (!engine->isInquiring)
+        return;
+    engine->isInquiring = false;
+    if (engine->onInquiryDone)
+        engine->onInquiryDone(engine->arg);
+}
+
+static void readEvents(struct HCIEngine *engine) {
+    unsigned char buf[HCI_MAX_EVENT_SIZE + 1];
+    while (1) {
+        struct HCISession *session = engine->session;
+        int len = session->transport->read(session, buf, sizeof(buf));
+        if (len < 0) {
+            if ((errno == EAGAIN) || (errno == EINTR))
+                return;
+            perror("Can't read HCI event");
+            exit(1);
+        }
+        if ((len < 1 + HCI_EVENT_HDR_SIZE) || (buf[0] != HCI_EVENT_PKT))
+            continue;
+        hci_event_hdr *hdr = (hci_event_hdr *)(buf + 1);
+        void *ptr = buf + 1 + HCI_EVENT_HDR_SIZE;
+        switch (hdr->evt) {
+          case EVT_CMD_STATUS:
+            onCmdStatus(engine, ptr);
+            break;
+          case EVT_CONN_COMPLETE:
+            onConnComplete(engine, ptr);
+            break;
+          case EVT_REMOTE_NAME_REQ_COMPLETE:
+            onNameComplete(engine, ptr);
+            break;
+          case EVT_READ_REMOTE_VERSION_COMPLETE:
+            onVerComplete(engine, ptr);
+            break;
+          case EVT_DISCONN_COMPLETE:
+            onDisconnComplete(engine, ptr);
+            break;
+          case EVT_INQUIRY_RESULT:
+            onInquiryResult(engine, ptr);
+            break;
+          case EVT_INQUIRY_RESULT_WITH_RSSI:
+            onInquiryResultRSSI(engine, ptr);
+            break;
+          case EVT_EXTENDED_INQUIRY_RESULT:
+            onExtInquiryResult(engine, ptr);
+            break;
+          case EVT_INQUIRY_COMPLETE:
+            onInquiryComplete(engine);
+            break;
+        }
+    }
+}
+
+static void checkDeadlines(struct HCIEngine *engine) {
+    int64_t now = nowMs();
+    for (int n = engine->closingCnt - 1; n >= 0; n--) {
+        if (engine->closing[n].deadline <= now)
+            dropClosing(engine, n);
+    }
+    struct HCIOp *op = engine->activeHead;
+    while (op) {
+        struct HCIOp *next = op->next;
+        if (op->deadline > now) {
+            op = next;
+            continue;
+        }
+        if (op->stage == STAGE_CONNECTING) {
+            create_conn_cancel_cp cp;
+            bacpy(&cp.bdaddr, &op->inquiryInfo.bdaddr);
+            sendCmd(
+              engine,
+              NULL,
+              OGF_LINK_CTL,
+              OCF_CREATE_CONN_CANCEL,
+              CREATE_CONN_CANCEL_CP_SIZE,
+              &cp);
+            op->stage = STAGE_CANCELLING;
+            op->info.isSuccess = false;
+            op->took.conn = -1;
+            op->deadline = now + CANCEL_TIMEOUT;
+        } else if (op->stage == STAGE_CANCELLING) {
+            finishOp(engine, op);
+        } else if (op->stage == STAGE_QUERYING) {
+            if (
+              op->isNamePending
+              && (op->queryAt + op->limit.name <= now)
+            ) {
+                remote_name_req_cancel_cp cp;
+                bacpy(&cp.bdaddr, &op->inquiryInfo.bdaddr);
+                sendCmd(
+                  engine,
+                  NULL,
+                  OGF_LINK_CTL,
+                  OCF_REMOTE_NAME_REQ_CANCEL,
+                  REMOTE_NAME_REQ_CANCEL_CP_SIZE,
+                  &cp);
+                op->isNamePending = false;
+                op->took.name = -1;
+            }
+            if (
+              op->isVerPending
+              && (op->queryAt + op->limit.ver <= now)
+            ) {
+                op->isVerPending = false;
+                op->took.ver = -1;
+            }
+            checkQueryDone(engine, op);
+        }
+        op = next;
+    }
+}
+
+static int hciSend(struct HCISession *session,
+                   uint16_t ogf,
+                   uint16_t ocf,
+                   uint8_t plen,
+                   void *param) {
+    return hci_send_cmd(session->socket, ogf, ocf, plen, param);
+}
+
+static int hciRead(struct HCISession *session, unsigned char *buf, int len) {
+    return read(session->socket, buf, len);
+}
+
+static bool hciFindConn(struct HCISession *session,
+                        const bdaddr_t *btAddr,
+                        uint16_t *handle) {
+    struct hci_conn_info_req *connInfoReq = session->connInfoReq;
+    bacpy(&connInfoReq->bdaddr, btAddr);
+    connInfoReq->type = ACL_LINK;
+    if (ioctl(
+      session->socket,
+      HCIGETCONNINFO,
+      (unsigned long)connInfoReq) < 0
+    )
+        return false;
+    // The kernel reports the handle in host order, as op->handle keeps it;
+    // only HCI packets carry it little-endian.
+    *handle = connInfoReq->conn_info->handle;
+    return true;
+}
+
+static void hciClose(struct HCISession *session) {
+    hci_close_dev(session->socket);
+    free(session->connInfoReq);
+}
+
+static const struct HCITransport HCI_TRANSPORT = {
+  hciSend,
+  hciRead,
+  hciFindConn,
+  hciClose
+};
+
+struct HCISession *SessionOpen(int devId) {
+    struct HCISession *session = calloc(1, sizeof(struct HCISession));
+    if (!session) {
+        perror("Can't allocate memory");
+        exit(1);
+    }
+    session->transport = &HCI_TRANSPORT;
+    session->devId = devId;
+    session->socket = hci_open_dev(devId);
+    if (session->socket < 0) {
+        perror("HCI device open failed");
+        exit(1);
+    }
+    session->devInfo.dev_id = devId;
+    if (ioctl(
+      session->socket,
+      HCIGETDEVINFO,
+      (void *)&session->devInfo) < 0
+    ) {
+        perror("Can't get device info");
+        exit(1);
+    }
+
+    struct hci_filter filter;
+    hci_filter_clear(&filter);
+    hci_filter_set_ptype(HCI_EVENT_PKT, &filter);
+    hci_filter_set_event(EVT_CMD_STATUS, &filter);
+    hci_filter_set_event(EVT_CONN_COMPLETE, &filter);
+    hci_filter_set_event(EVT_DISCONN_COMPLETE, &filter);
+    hci_filter_set_event(EVT_REMOTE_NAME_REQ_COMPLETE, &filter);
+    hci_filter_set_event(EVT_READ_REMOTE_VERSION_COMPLETE, &filter);
+    hci_filter_set_event(EVT_INQUIRY_RESULT, &filter);
+    hci_filter_set_event(EVT_INQUIRY_RESULT_WITH_RSSI, &filter);
+    hci_filter_set_event(EVT_EXTENDED_INQUIRY_RESULT, &filter);
+    hci_filter_set_event(EVT_INQUIRY_COMPLETE, &filter);
+    if (setsockopt(
+      session->socket,
+      SOL_HCI,
+      HCI_FILTER,
+      &filter,
+      sizeof(filter)) < 0
+    ) {
+        perror("Can't set HCI filter");
+        exit(1);
+    }
+    int flags = fcntl(session->socket, F_GETFL, 0);
+    fcntl(session->socket, F_SETFL, flags | O_NONBLOCK);
+
+    session->epollFd = epoll_create1(0);
+    if (session->epollFd < 0) {
+        perror("Can't create epoll");
+        exit(1);
+    }
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.fd = session->socket;
+    if (epoll_ctl(
+      session->epollFd,
+      EPOLL_CTL_ADD,
+      session->socket,
+      &event) < 0
+    ) {
+        perror("Can't watch HCI socket");
+        exit(1);
+    }
+
+    session->connInfoReq = malloc(
+      sizeof(struct hci_conn_info_req) + sizeof(struct hci_conn_info));
+    if (!session->connInfoReq) {
+        perror("Can't allocate memory");
+        exit(1);
+    }
+    return session;
+}
+
+void SessionClose(struct HCISession *session) {
+    session->transport->close(session);
+    close(session->epollFd);
+    free(session);
+}
+
+struct HCIEngine *EngineOpen(struct HCISession *session,
+                             int maxOps,
+                             void (*onDone)(struct HCIOp *op, void *arg),
+                             void *arg) {
+    struct HCIEngine *engine = calloc(1, sizeof(struct HCIEngine));
+    if (!engine) {
+        perror("Can't allocate memory");
+        exit(1);
+    }
+    engine->session = session;
+    engine->maxOps = maxOps;
+    engine->closing = calloc(maxOps, sizeof(struct HCILink));
+    engine->cmdCap = maxOps * CMDS_PER_OP + 1;
+    engine->cmds = calloc(engine->cmdCap, sizeof(struct HCICmd));
+    if (!engine->closing || !engine->cmds) {
+        perror("Can't allocate memory");
+        exit(1);
+    }
+    engine->onDone = onDone;
+    engine->arg = arg;
+
+    struct hci_dev_info *hciDevInfo = &session->devInfo;
+    engine->pktType = htobs(hciDevInfo->pkt_type & ACL_PTYPE_MASK);
+    // Prefer Extended Inquiry Results, which carry the name; controllers
+    // that can't do RSSI either reject mode 1 and keep the standard one.
+    if (hciDevInfo->features[6] & LMP_EXT_INQ)
+        engine->inquiryMode = 0x02;
+    else
+        engine->inquiryMode = 0x01;
+    return engine;
+}
+
+void EngineSubmit(struct HCIEngine *engine,
+                  inquiry_info *inquiryInfo,
+                  const struct HCIStageMs *limit,
+                  void *ctx) {
+    struct HCIOp *op = engine->freeHead;
+    if (op) {
+        engine->freeHead = op->next;
+        memset(op, 0, sizeof(*op));
+    } else {
+        op = calloc(1, sizeof(struct HCIOp));
+        if (!op) {
+            perror("Can't allocate memory");
+            exit(1);
+        }
+    }
+    op->inquiryInfo = *inquiryInfo;
+    op->stage = STAGE_QUEUED;
+    op->ctx = ctx;
+    op->limit.conn = CONN_TIMEOUT;
+    op->limit.name = NAME_TIMEOUT;
+    op->limit.ver = VER_TIMEOUT;
+    if (limit && (limit->conn > 0))
+        op->limit.conn = limit->conn;
+    if (limit && (limit->name > 0))
+        op->limit.name = limit->name;
+    if (limit && (limit->ver > 0))
+        op->limit.ver = limit->ver;
+    ba2str(&inquiryInfo->bdaddr, op->info.addr);
+    if (engine->waitTail)
+        engine->waitTail->next = op;
+    else
+        engine->waitHead = op;
+    engine->waitTail = op;
+    startWaiting(engine);
+}
+
+// Start one inquiry of len * 1.28 s; results arrive through onFound as
+// they are heard, with the raw EIR data when the controller sends it,
+// and onInquiryDone fires when the inquiry ends.
+void EngineInquire(struct HCIEngine *engine, uint8_t len) {
+    if (!engine->inquiryLen) {
+        write_inquiry_mode_cp cp;
+        cp.mode = engine->inquiryMode;
+        sendCmd(
+          engine,
+          NULL,
+          OGF_HOST_CTL,
+          OCF_WRITE_INQUIRY_MODE,
+          WRITE_INQUIRY_MODE_CP_SIZE,
+          &cp);
+    }
+    engine->inquiryLen = len;
+    sendInquiry(engine);
+}
+
+// Wait up to timeout ms (-1 for the next deadline) for HCI events and
+// advance every operation in flight. The engine hands each finished
+// operation to onDone, which must copy what it needs; the operation is
+// reused once onDone returns. Returns the number of
+// finished operations, or -1 when interrupted by a signal.
+int EnginePoll(struct HCIEngine *engine, int timeout) {
+    int64_t now = nowMs();
+    for (struct HCIOp *op = engine->activeHead; op; op = op->next) {
+        int left = op->deadline > now ? (int)(op->deadline - now) : 0;
+        if ((timeout < 0) || (left < timeout))
+            timeout = left;
+    }
+    for (int n = 0; n < engine->closingCnt; n++) {
+        int64_t deadline = engine->closing[n].deadline;
+        int left = deadline > now ? (int)(deadline - now) : 0;
+        if ((timeout < 0) || (left < timeout))
+            timeout = left;
+    }
+    if (engine->inquiryRetryAt > 0) {
+        int left = engine->inquiryRetryAt > now
+          ? (int)(engine->inquiryRetryAt - now)
+          : 0;
+        if ((timeout < 0) || (left < timeout))
+            timeout = left;
+    }
+    struct epoll_event event;
+    int num = epoll_wait(engine->session->epollFd, &event, 1, timeout);
+    if (num < 0) {
+        if (errno == EINTR)
+            return -1;
+        perror("Can't wait for HCI events");
+        exit(1);
+    }
+    int doneCnt = engine->activeCnt;
+    if (num > 0)
+        readEvents(engine);
+    checkDeadlines(engine);
+    if (
+      (engine->inquiryRetryAt > 0)
+      && (engine->inquiryRetryAt <= nowMs())
+    )
+        sendInquiry(engine);
+    doneCnt -= engine->activeCnt;
+    startWaiting(engine);
+    return doneCnt;
+}
+
+bool EngineIsIdle(struct HCIEngine *engine) {
+    return !engine->activeHead && !engine->waitHead && !engine->closingCnt;
+}
+
+void EngineClose(struct HCIEngine *engine) {
+    while (engine->freeHead) {
+        struct HCIOp *op = engine->freeHead;
+        engine->freeHead = op->next;
+        free(op);
+    }
+    free(engine->closing);
+    free(engine->cmds);
+    free(engine);
+}
@@ -0,0 +1,142 @@
+/*
+ * Scan Bluetooth's for Info
+ * Copyright (C) 2025 Hermawan <minghermawan@yahoo.com>
+ * https://www.linkedin.com/in/hermawan-ho-a3801194/
+ * GNU General Public License (GPL) v3.0
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/hci.h>
+
+// Include btinfo.h before this header.
+//
+// Operations page with the pscan_rep_mode and clock_offset of their
+// inquiry_info. Bit 15 of clock_offset marks the offset as valid, as in
+// the HCI Create Connection command; without it the controller pages
+// from its own estimate.
+
+// HCI reports 127 when no RSSI is available.
+#define RSSI_UNKNOWN 127
+
+enum HCIStage {
+    STAGE_QUEUED,
+    STAGE_CONNECTING,
+    STAGE_QUERYING,
+    STAGE_CANCELLING,
+    STAGE_DONE
+};
+
+// Milliseconds per stage. As a limit, 0 keeps the engine default; as a
+// result, 0 means the stage was not needed and -1 that it failed or
+// timed out.
+struct HCIStageMs {
+    int conn;
+    int name;
+    int ver;
+};
+
+struct HCIOp {
+    inquiry_info inquiryInfo;
+    enum HCIStage stage;
+    uint16_t handle;
+    bool isOwnConn;
+    bool isNamePending;
+    bool isVerPending;
+    int64_t deadline;
+    int64_t startedAt;
+    int64_t queryAt;
+    struct HCIStageMs limit;
+    struct HCIStageMs took;
+    struct InfoStruct info;
+    void *ctx;
+    struct HCIOp *next;
+};
+
+struct HCISession;
+
+// What the engine needs from an adapter. send() queues one HCI command,
+// read() returns one event packet or -1 with errno EAGAIN when none is
+// ready and findConn() looks up an existing ACL link. Events become
+// readable through the session epollFd.
+struct HCITransport {
+    int (*send)(struct HCISession *session,
+                uint16_t ogf,
+                uint16_t ocf,
+                uint8_t plen,
+                void *param);
+    int (*read)(struct HCISession *session, unsigned char *buf, int len);
+    bool (*findConn)(struct HCISession *session,
+                     const bdaddr_t *btAddr,
+                     uint16_t *handle);
+    void (*close)(struct HCISession *session);
+};
+
+// One open adapter for the whole run: its transport, the raw HCI socket
+// with its event filter, the adapter info read at open, and the buffer
+// reused by every connection lookup. A simulated adapter keeps its own
+// state in backend instead of a socket.
+struct HCISession {
+    const struct HCITransport *transport;
+    void *backend;
+    int devId;
+    int socket;
+    int epollFd;
+    struct hci_dev_info devInfo;
+    struct hci_conn_info_req *connInfoReq;
+};
+
+// A link we disconnected keeps its ACL slot until Disconnection Complete.
+struct HCILink {
+    uint16_t handle;
+    int64_t deadline;
+};
+
+struct HCICmd {
+    uint16_t opcode;
+    struct HCIOp *op;
+};
+
+struct HCIEngine {
+    struct HCISession *session;
+    uint16_t pktType;
+    int maxOps;
+    int activeCnt;
+    struct HCIOp *waitHead;
+    struct HCIOp *waitTail;
+    struct HCIOp *activeHead;
+    struct HCIOp *freeHead;
+    struct HCILink *closing;
+    int closingCnt;
+    struct HCICmd *cmds;
+    int cmdCap;
+    int cmdHead;
+    int cmdCnt;
+    uint8_t inquiryMode;
+    uint8_t inquiryLen;
+    bool isInquiring;
+    int64_t inquiryRetryAt;
+    void (*onDone)(struct HCIOp *op, void *arg);
+    void (*onFound)(inquiry_info *inquiryInfo,
+                    int8_t rssi,
+                    const uint8_t *eir,
+                    void *arg);
+    void (*onInquiryDone)(void *arg);
+    void *arg;
+};
+
+struct HCISession *SessionOpen(int devId);
+void SessionClose(struct HCISession *session);
+
+struct HCIEngine *EngineOpen(struct HCISession *session,
+                             int maxOps,
+                             void (*onDone)(struct HCIOp *op, void *arg),
+                             void *arg);
+void EngineSubmit(struct HCIEngine *engine,
+                  inquiry_info *inquiryInfo,
+                  const struct HCIStageMs *limit,
+                  void *ctx);
+void EngineInquire(struct HCIEngine *engine, uint8_t len);
+int EnginePoll(struct HCIEngine *engine, int timeout);
+bool EngineIsIdle(struct HCIEngine *engine);
+void EngineClose(struct HCIEngine *engine);
@@ -0,0 +1,668 @@
+/*
+ * Scan Bluetooth's for Info
+ * Copyright (C) 2025 Hermawan <minghermawan@yahoo.com>
+ * https://www.linkedin.com/in/hermawan-ho-a3801194/
+ * GNU General Public License (GPL) v3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/hci.h>
+#include <bluetooth/hci_lib.h>
+#include "btcache.h"
+#include "btinfo.h"
+#include "hciasync.h"
+#include "hcisim.h"
+
+const int SIM_PAGE_TIMEOUT = 5120;
+const int SIM_DISCONN_MS = 20;
+const uint8_t SIM_STATUS_UNKNOWN_CMD = 0x01;
+const uint8_t SIM_STATUS_NO_CONN = 0x02;
+const uint8_t SIM_STATUS_PAGE_TIMEOUT = 0x04;
+const uint8_t SIM_STATUS_LIMIT = 0x09;
+
+// Common Class of Device values and the word used in their names.
+static const uint32_t SIM_CLASSES[] = {
+  0x5A020C, 0x1C010C, 0x240404, 0x240418, 0x240414,
+  0x340408, 0x000704, 0x002540, 0x002580
+};
+static const char *const SIM_KINDS[] = {
+  "Phone", "Laptop", "Headset", "Headphones", "Speaker",
+  "Car Kit", "Watch", "Keyboard", "Mouse"
+};
+static const uint16_t SIM_MANUFACTURERS[] = {2, 10, 15, 29, 70, 76, 93};
+static const uint32_t SIM_OUIS[] = {
+  0x001A7D, 0x001B66, 0x28C2DD, 0x3C2EFF, 0xACDE48, 0xF0D5BF
+};
+
+#define SIM_CNT(arr) ((int)(sizeof(arr) / sizeof(arr[0])))
+
+static int64_t nowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static uint64_t nextRand(struct SimState *sim) {
+    sim->rand ^= sim->rand << 13;
+    sim->rand ^= sim->rand >> 7;
+    sim->rand ^= sim->rand << 17;
+    return sim->rand;
+}
+
+static double randUnit(struct SimState *sim) {
+    return (nextRand(sim) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Log-normal around median, from a Box-Muller normal.
+static int randMs(struct SimState *sim, int median) {
+    double u1 = 1.0 - randUnit(sim);
+    double u2 = randUnit(sim);
+    double z = sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+    return (int)(median * exp(sim->config.spread * z));
+}
+
+static void randAddr(struct SimState *sim, struct SimDevice *dev) {
+    uint64_t val = nextRand(sim);
+    for (int n = 0; n < 6; n++)
+        dev->addr.b[n] = (uint8_t)(val >> (n * 8));
+    if (dev->isRandomAddr)
+        return;
+    uint32_t oui = SIM_OUIS[(val >> 48) % SIM_CNT(SIM_OUIS)];
+    dev->addr.b[5] = oui >> 16;
+    dev->addr.b[4] = oui >> 8;
+    dev->addr.b[3] = oui;
+}
+
+static void buildIndex(struct SimState *sim) {
+    IndexFree(&sim->index);
+    IndexInit(&sim->index, sim->config.deviceCnt);
+    for (int n = 0; n < sim->config.deviceCnt; n++)
+        IndexPut(&sim->index, &sim->devices[n].addr, n);
+}
+
+static void initDevice(struct SimState *sim, int idx) {
+    struct SimDevice *dev = &sim->devices[idx];
+    int kind = nextRand(sim) % SIM_CNT(SIM_CLASSES);
+    dev->kind = kind;
+    dev->devClass[0] = SIM_CLASSES[kind];
+    dev->devClass[1] = SIM_CLASSES[kind] >> 8;
+    dev->devClass[2] = SIM_CLASSES[kind] >> 16;
+    dev->lmpVer = 6 + nextRand(sim) % 7;
+    dev->lmpSubVer = nextRand(sim);
+    dev->manufacturer =
+      SIM_MANUFACTURERS[nextRand(sim) % SIM_CNT(SIM_MANUFACTURERS)];
+    dev->rssi = -90 + (int)(nextRand(sim) % 51);
+    dev->clockOffset = nextRand(sim) & 0x7FFF;
+    dev->isRandomAddr = randUnit(sim) < sim->config.randomAddrRate;
+    snprintf(dev->name, sizeof(dev->name), "%s %d", SIM_KINDS[kind], idx);
+    randAddr(sim, dev);
+}
+
+static bool isEarlier(struct SimEvent *a, struct SimEvent *b) {
+    return (a->at < b->at) || ((a->at == b->at) && (a->seq < b->seq));
+}
+
+static void siftUp(struct SimState *sim, int n) {
+    while (n > 0) {
+        int parent = (n - 1) / 2;
+        if (!isEarlier(sim->events[n], sim->events[parent]))
+            break;
+        struct SimEvent *evt = sim->events[n];
+        sim->events[n] = sim->events[parent];
+        sim->events[parent] = evt;
+        n = parent;
+    }
+}
+
+static void siftDown(struct SimState *sim, int n) {
+    while (1) {
+        int first = n;
+        int left = 2 * n + 1;
+        int right = left + 1;
+        if(
+          (left < sim->eventCnt)
+          && isEarlier(sim->events[left], sim->events[first])
+        )
+            first = left;
+        if(
+          (right < sim->eventCnt)
+          && isEarlier(sim->events[right], sim->events[first])
+        )
+            first = right;
+        if (first == n)
+            return;
+        struct SimEvent *evt = sim->events[n];
+        sim->events[n] = sim->events[first];
+        sim->events[first] = evt;
+        n = first;
+    }
+}
+
+static void pushEvt(struct SimState *sim,
+                    int64_t at,
+                    uint8_t code,
+                    const void *param,
+                    uint8_t plen) {
+    if (sim->eventCnt == sim->eventCap) {
+        sim->eventCap = sim->eventCap ? sim->eventCap * 2 : 256;
+        struct SimEvent **grown = realloc(
+          sim->events,
+          sim->eventCap * sizeof(struct SimEvent *));
+        if (!grown) {
+            perror("Can't allocate memory");
+            exit(1);
+        }
+        sim->events = grown;
+    }
+    struct SimEvent *evt = malloc(sizeof(struct SimEvent));
+    if (!evt) {
+        perror("Can't allocate memory");
+        exit(1);
+    }
+    evt->at = at;
+    evt->seq = sim->eventSeq++;
+    evt->len = 1 + HCI_EVENT_HDR_SIZE + plen;
+    evt->buf[0] = HCI_EVENT_PKT;
+    evt->buf[1] = code;
+    evt->buf[2] = plen;
+    memcpy(evt->buf + 1 + HCI_EVENT_HDR_SIZE, param, plen);
+    sim->events[sim->eventCnt] = evt;
+    sim->eventCnt += 1;
+    siftUp(sim, sim->eventCnt - 1);
+}
+
+static struct SimEvent *popEvt(struct SimState *sim) {
+    struct SimEvent *evt = sim->events[0];
+    sim->eventCnt -= 1;
+    sim->events[0] = sim->events[sim->eventCnt];
+    siftDown(sim, 0);
+    return evt;
+}
+
+static void armTimer(struct SimState *sim) {
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    if (sim->eventCnt > 0) {
+        int64_t at = sim->events[0]->at;
+        spec.it_value.tv_sec = at / 1000;
+        spec.it_value.tv_nsec = (at % 1000) * 1000000;
+    }
+    timerfd_settime(sim->timerFd, TFD_TIMER_ABSTIME, &spec, NULL);
+}
+
+static void cmdStatus(struct SimState *sim,
+                      uint8_t status,
+                      uint16_t ogf,
+                      uint16_t ocf) {
+    evt_cmd_status evt;
+    evt.status = status;
+    evt.ncmd = 1;
+    evt.opcode = htobs(cmd_opcode_pack(ogf, ocf));
+    pushEvt(sim, nowMs(), EVT_CMD_STATUS, &evt, EVT_CMD_STATUS_SIZE);
+}
+
+// A device answers only at the address it uses now.
+static int findDevice(struct SimState *sim, const bdaddr_t *btAddr) {
+    int idx = IndexFind(&sim->index, btAddr);
+    if ((idx < 0) || (bacmp(&sim->devices[idx].addr, btAddr) != 0))
+        return -1;
+    return idx;
+}
+
+static int findLink(struct SimState *sim, uint16_t handle) {
+    for (int n = 0; n < sim->linkCnt; n++) {
+        if (sim->links[n].handle == handle)
+            return n;
+    }
+    return -1;
+}
+
+static void dropLink(struct SimState *sim, int n) {
+    sim->linkCnt -= 1;
+    sim->links[n] = sim->links[sim->linkCnt];
+}
+
+// Complete a pending connection or name request now with status 0x02,
+// as a controller does when the command is cancelled.
+static void cancelEvt(struct SimState *sim,
+                      uint8_t code,
+                      const bdaddr_t *btAddr) {
+    for (int n = 0; n < sim->eventCnt; n++) {
+        struct SimEvent *evt = sim->events[n];
+        uint8_t *param = evt->buf + 1 + HCI_EVENT_HDR_SIZE;
+        if (evt->buf[1] != code)
+            continue;
+        if (code == EVT_CONN_COMPLETE) {
+            evt_conn_complete *conn = (evt_conn_complete *)param;
+            if (bacmp(&conn->bdaddr, btAddr) != 0)
+                continue;
+            int link = findLink(sim, btohs(conn->handle));
+            if ((conn->status == 0) && (link >= 0))
+                dropLink(sim, link);
+            conn->status = SIM_STATUS_NO_CONN;
+        } else {
+            evt_remote_name_req_complete *name =
+              (evt_remote_name_req_complete *)param;
+            if (bacmp(&name->bdaddr, btAddr) != 0)
+                continue;
+            name->status = SIM_STATUS_NO_CONN;
+        }
+        evt->at = nowMs();
+        siftUp(sim, n);
+        return;
+    }
+}
+
+// Rename and move devices as they would between two inquiries, and
+// return how long the inquiry lasts.
+static int beginInquiry(struct SimState *sim, uint8_t len) {
+    bool isMoved = false;
+    for (int n = 0; n < sim->config.deviceCnt; n++) {
+        struct SimDevice *dev = &sim->devices[n];
+        if (randUnit(sim) < sim->config.churnRate) {
+            dev->nameRev += 1;
+            snprintf(
+              dev->name,
+              sizeof(dev->name),
+              "%s %d v%u",
+              SIM_KINDS[dev->kind],
+              n,
+              dev->nameRev);
+        }
+        if (dev->isRandomAddr) {
+            randAddr(sim, dev);
+            isMoved = true;
+        }
+    }
+    if (isMoved)
+        buildIndex(sim);
+    if (sim->config.inquiryMs > 0)
+        return sim->config.inquiryMs;
+    return len * 1280;
+}
+
+static void pushFound(struct SimState *sim, int64_t at, int idx) {
+    struct SimDevice *dev = &sim->devices[idx];
+    uint8_t param[1 + sizeof(extended_inquiry_info)];
+    memset(param, 0, sizeof(param));
+    param[0] = 1;
+    if (sim->inquiryMode == 0x02) {
+        extended_inquiry_info *info = (extended_inquiry_info *)(param + 1);
+        bacpy(&info->bdaddr, &dev->addr);
+        info->pscan_rep_mode = 0x01;
+        memcpy(info->dev_class, dev->devClass, 3);
+        info->clock_offset = htobs(dev->clockOffset);
+        info->rssi = dev->rssi;
+        // Complete local name, then TX power level.
+        int nameLen = strlen(dev->name);
+        info->data[0] = 1 + nameLen;
+        info->data[1] = 0x09;
+        memcpy(info->data + 2, dev->name, nameLen);
+        info->data[2 + nameLen] = 2;
+        info->data[3 + nameLen] = 0x0A;
+        info->data[4 + nameLen] = 4;
+        pushEvt(
+          sim,
+          at,
+          EVT_EXTENDED_INQUIRY_RESULT,
+          param,
+          1 + sizeof(extended_inquiry_info));
+    } else if (sim->inquiryMode == 0x01) {
+        inquiry_info_with_rssi *info = (inquiry_info_with_rssi *)(param + 1);
+        bacpy(&info->bdaddr, &dev->addr);
+        info->pscan_rep_mode = 0x01;
+        memcpy(info->dev_class, dev->devClass, 3);
+        info->clock_offset = htobs(dev->clockOffset);
+        info->rssi = dev->rssi;
+        pushEvt(
+          sim,
+          at,
+          EVT_INQUIRY_RESULT_WITH_RSSI,
+          param,
+          1 + sizeof(inquiry_info_with_rssi));
+    } else {
+        inquiry_info *info = (inquiry_info *)(param + 1);
+        bacpy(&info->bdaddr, &dev->addr);
+        info->pscan_rep_mode = 0x01;
+        memcpy(info->dev_class, dev->devClass, 3);
+        info->clock_offset = htobs(dev->clockOffset);
+        pushEvt(
+          sim,
+          at,
+          EVT_INQUIRY_RESULT,
+          param,
+          1 + sizeof(inquiry_info));
+    }
+}
+
+static void startInquiry(struct SimState *sim, uint8_t len) {
+    int64_t now = nowMs();
+    int duration = beginInquiry(sim, len);
+    for (int n = 0; n < sim->config.deviceCnt; n++) {
+        if (randUnit(sim) < sim->config.visibleRate)
+            pushFound(sim, now + (int64_t)(randUnit(sim) * duration), n);
+    }
+    uint8_t status = 0;
+    pushEvt(sim, now + duration, EVT_INQUIRY_COMPLETE, &status, 1);
+}
+
+static void createConn(struct SimState *sim, create_conn_cp *cp) {
+    int64_t now = nowMs();
+    evt_conn_complete evt;
+    memset(&evt, 0, sizeof(evt));
+    bacpy(&evt.bdaddr, &cp->bdaddr);
+    evt.link_type = ACL_LINK;
+    int idx = findDevice(sim, &cp->bdaddr);
+    if ((idx < 0) || (randUnit(sim) < sim->config.pageFailRate)) {
+        evt.status = SIM_STATUS_PAGE_TIMEOUT;
+        now += SIM_PAGE_TIMEOUT;
+    } else if (sim->linkCnt == SIM_CNT(sim->links)) {
+        evt.status = SIM_STATUS_LIMIT;
+    } else {
+        sim->nextHandle = sim->nextHandle % 0x0EFF + 1;
+        sim->links[sim->linkCnt].handle = sim->nextHandle;
+        sim->links[sim->linkCnt].devIdx = idx;
+        sim->linkCnt += 1;
+        evt.handle = htobs(sim->nextHandle);
+        now += randMs(sim, sim->config.connMs);
+    }
+    pushEvt(sim, now, EVT_CONN_COMPLETE, &evt, EVT_CONN_COMPLETE_SIZE);
+}
+
+static void requestName(struct SimState *sim, remote_name_req_cp *cp) {
+    int idx = findDevice(sim, &cp->bdaddr);
+    evt_remote_name_req_complete evt;
+    memset(&evt, 0, sizeof(evt));
+    bacpy(&evt.bdaddr, &cp->bdaddr);
+    int64_t at = nowMs();
+    if (idx < 0) {
+        evt.status = SIM_STATUS_PAGE_TIMEOUT;
+        at += SIM_PAGE_TIMEOUT;
+    } else if (randUnit(sim) < sim->config.nameFailRate) {
+        // Never answers; the engine gives up and cancels.
+        return;
+    } else {
+        const char *name = sim->devices[idx].name;
+        memcpy(evt.name, name, strlen(name));
+        at += randMs(sim, sim->config.nameMs);
+    }
+    pushEvt(
+      sim,
+      at,
+      EVT_REMOTE_NAME_REQ_COMPLETE,
+      &evt,
+      EVT_REMOTE_NAME_REQ_COMPLETE_SIZE);
+}
+
+static void readVersion(struct SimState *sim, read_remote_version_cp *cp) {
+    int link = findLink(sim, btohs(cp->handle));
+    if (randUnit(sim) < sim->config.verFailRate)
+        return;
+    struct SimDevice *dev = &sim->devices[sim->links[link].devIdx];
+    evt_read_remote_version_complete evt;
+    evt.status = 0;
+    evt.handle = cp->handle;
+    evt.lmp_ver = dev->lmpVer;
+    evt.manufacturer = htobs(dev->manufacturer);
+    evt.lmp_subver = htobs(dev->lmpSubVer);
+    pushEvt(
+      sim,
+      nowMs() + randMs(sim, sim->config.verMs),
+      EVT_READ_REMOTE_VERSION_COMPLETE,
+      &evt,
+      EVT_READ_REMOTE_VERSION_COMPLETE_SIZE);
+}
+
+static void disconnect(struct SimState *sim, disconnect_cp *cp) {
+    int link = findLink(sim, btohs(cp->handle));
+    if (link < 0)
+        return;
+    dropLink(sim, link);
+    evt_disconn_complete evt;
+    evt.status = 0;
+    evt.handle = cp->handle;
+    evt.reason = 0x16;
+    pushEvt(
+      sim,
+      nowMs() + SIM_DISCONN_MS,
+      EVT_DISCONN_COMPLETE,
+      &evt,
+      EVT_DISCONN_COMPLETE_SIZE);
+}
+
+// Commands answer as a controller would; those that a controller
+// answers with Command Complete, which the engine filters out, get no
+// event at all.
+static int simSend(struct HCISession *session,
+                   uint16_t ogf,
+                   uint16_t ocf,
+                   uint8_t plen,
+                   void *param) {
+    struct SimState *sim = session->backend;
+    uint16_t opcode = cmd_opcode_pack(ogf, ocf);
+    if (opcode == cmd_opcode_pack(OGF_HOST_CTL, OCF_WRITE_INQUIRY_MODE)) {
+        sim->inquiryMode = ((write_inquiry_mode_cp *)param)->mode;
+    } else if (opcode == cmd_opcode_pack(OGF_LINK_CTL, OCF_INQUIRY)) {
+        cmdStatus(sim, 0, ogf, ocf);
+        startInquiry(sim, ((inquiry_cp *)param)->length);
+    } else if (opcode == cmd_opcode_pack(OGF_LINK_CTL, OCF_CREATE_CONN)) {
+        cmdStatus(sim, 0, ogf, ocf);
+        createConn(sim, param);
+    } else if (
+      opcode == cmd_opcode_pack(OGF_LINK_CTL, OCF_CREATE_CONN_CANCEL)
+    ) {
+        cancelEvt(
+          sim,
+          EVT_CONN_COMPLETE,
+          &((create_conn_cancel_cp *)param)->bdaddr);
+    } else if (
+      opcode == cmd_opcode_pack(OGF_LINK_CTL, OCF_REMOTE_NAME_REQ)
+    ) {
+        cmdStatus(sim, 0, ogf, ocf);
+        requestName(sim, param);
+    } else if (
+      opcode == cmd_opcode_pack(OGF_LINK_CTL, OCF_REMOTE_NAME_REQ_CANCEL)
+    ) {
+        cancelEvt(
+          sim,
+          EVT_REMOTE_NAME_REQ_COMPLETE,
+          &((remote_name_req_cancel_cp *)param)->bdaddr);
+    } else if (
+      opcode == cmd_opcode_pack(OGF_LINK_CTL, OCF_READ_REMOTE_VERSION)
+    ) {
+        uint16_t handle = btohs(((read_remote_version_cp *)param)->handle);
+        if (findLink(sim, handle) < 0) {
+            cmdStatus(sim, SIM_STATUS_NO_CONN, ogf, ocf);
+        } else {
+            cmdStatus(sim, 0, ogf, ocf);
+            readVersion(sim, param);
+        }
+    } else if (opcode == cmd_opcode_pack(OGF_LINK_CTL, OCF_DISCONNECT)) {
+        cmdStatus(sim, 0, ogf, ocf);
+        disconnect(sim, param);
+    } else {
+        cmdStatus(sim, SIM_STATUS_UNKNOWN_CMD, ogf, ocf);
+    }
+    armTimer(sim);
+    return 0;
+}
+
+static int simRead(struct HCISession *session, unsigned char *buf, int len) {
+    struct SimState *sim = session->backend;
+    // Drain the timer; it is re-armed below once no event is due.
+    uint64_t expired;
+    if (read(sim->timerFd, &expired, sizeof(expired)) < 0)
+        expired = 0;
+    if ((sim->eventCnt == 0) || (sim->events[0]->at > nowMs())) {
+        armTimer(sim);
+        errno = EAGAIN;
+        return -1;
+    }
+    struct SimEvent *evt = popEvt(sim);
+    if (evt->len < len)
+        len = evt->len;
+    memcpy(buf, evt->buf, len);
+    free(evt);
+    return len;
+}
+
+// Only the engine opens links on a simulated adapter.
+static bool simFindConn(struct HCISession *session,
+                        const bdaddr_t *btAddr,
+                        uint16_t *handle) {
+    return false;
+}
+
+static void simClose(struct HCISession *session) {
+    struct SimState *sim = session->backend;
+    while (sim->eventCnt > 0)
+        free(popEvt(sim));
+    free(sim->events);
+    IndexFree(&sim->index);
+    free(sim->devices);
+    close(sim->timerFd);
+    free(sim);
+}
+
+static const struct HCITransport SIM_TRANSPORT = {
+  simSend,
+  simRead,
+  simFindConn,
+  simClose
+};
+
+void SimDefaults(struct SimConfig *config) {
+    memset(config, 0, sizeof(*config));
+    config->deviceCnt = 1000;
+    config->seed = 1;
+    config->connMs = 1300;
+    config->nameMs = 400;
+    config->verMs = 150;
+    config->spread = 0.6;
+    config->visibleRate = 0.9;
+    config->pageFailRate = 0.15;
+    config->nameFailRate = 0.02;
+    config->verFailRate = 0.02;
+    config->churnRate = 0.01;
+    config->randomAddrRate = 0.05;
+}
+
+static bool setOption(struct SimConfig *config,
+                      const char *key,
+                      const char *val) {
+    if (strcmp(key, "devices") == 0)
+        config->deviceCnt = atoi(val);
+    else if (strcmp(key, "seed") == 0)
+        config->seed = strtoull(val, NULL, 0);
+    else if (strcmp(key, "inquiry_ms") == 0)
+        config->inquiryMs = atoi(val);
+    else if (strcmp(key, "conn_ms") == 0)
+        config->connMs = atoi(val);
+    else if (strcmp(key, "name_ms") == 0)
+        config->nameMs = atoi(val);
+    else if (strcmp(key, "ver_ms") == 0)
+        config->verMs = atoi(val);
+    else if (strcmp(key, "spread") == 0)
+        config->spread = atof(val);
+    else if (strcmp(key, "visible") == 0)
+        config->visibleRate = atof(val);
+    else if (strcmp(key, "page_fail") == 0)
+        config->pageFailRate = atof(val);
+    else if (strcmp(key, "name_fail") == 0)
+        config->nameFailRate = atof(val);
+    else if (strcmp(key, "ver_fail") == 0)
+        config->verFailRate = atof(val);
+    else if (strcmp(key, "churn") == 0)
+        config->churnRate = atof(val);
+    else if (strcmp(key, "random_addr") == 0)
+        config->randomAddrRate = atof(val);
+    else
+        return false;
+    return true;
+}
+
+// Read "key=value,..." settings over the defaults; a bare number is the
+// device count.
+bool SimParse(struct SimConfig *config, const char *spec) {
+    char *buf = strdup(spec);
+    if (!buf) {
+        perror("Can't allocate memory");
+        exit(1);
+    }
+    bool isValid = true;
+    char *save = NULL;
+    for(
+      char *item = strtok_r(buf, ",", &save);
+      item && isValid;
+      item = strtok_r(NULL, ",", &save)
+    ) {
+        char *val = strchr(item, '=');
+        if (!val) {
+            isValid = setOption(config, "devices", item);
+            continue;
+        }
+        *val = '\0';
+        isValid = setOption(config, item, val + 1);
+    }
+    free(buf);
+    return isValid && (config->deviceCnt > 0);
+}
+
+// Open a simulated adapter whose devices answer inquiries and requests
+// through timed HCI events, so the engine runs unchanged without root
+// or hardware.
+struct HCISession *SimSessionOpen(const struct SimConfig *config) {
+    struct HCISession *session = calloc(1, sizeof(struct HCISession));
+    struct SimState *sim = calloc(1, sizeof(struct SimState));
+    if (!session || !sim) {
+        perror("Can't allocate memory");
+        exit(1);
+    }
+    sim->config = *config;
+    sim->rand = config->seed ? config->seed : 0x9E3779B97F4A7C15ULL;
+    sim->devices = calloc(config->deviceCnt, sizeof(struct SimDevice));
+    if (!sim->devices) {
+        perror("Can't allocate memory");
+        exit(1);
+    }
+    for (int n = 0; n < config->deviceCnt; n++)
+        initDevice(sim, n);
+    buildIndex(sim);
+
+    session->transport = &SIM_TRANSPORT;
+    session->backend = sim;
+    session->devId = -1;
+    session->socket = -1;
+    strcpy(session->devInfo.name, "sim0");
+    str2ba("00:00:5E:00:53:01", &session->devInfo.bdaddr);
+    session->devInfo.features[3] = LMP_RSSI_INQ;
+    session->devInfo.features[6] = LMP_EXT_INQ;
+
+    sim->timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    session->epollFd = epoll_create1(0);
+    if ((sim->timerFd < 0) || (session->epollFd < 0)) {
+        perror("Can't create simulated adapter");
+        exit(1);
+    }
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.fd = sim->timerFd;
+    if (epoll_ctl(
+      session->epollFd,
+      EPOLL_CTL_ADD,
+      sim->timerFd,
+      &event) < 0
+    ) {
+        perror("Can't watch simulated adapter");
+        exit(1);
+    }
+    return session;
+}
@@ -0,0 +1,81 @@
+/*
+ * Scan Bluetooth's for Info
+ * Copyright (C) 2025 Hermawan <minghermawan@yahoo.com>
+ * https://www.linkedin.com/in/hermawan-ho-a3801194/
+ * GNU General Public License (GPL) v3.0
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/hci.h>
+
+// Include btcache.h and hciasync.h before this header.
+
+// A simulated adapter and the devices around it. Stage times are
+// log-normal around the given medians with spread as sigma, and the fail
+// rates are chances per request. visibleRate and churnRate are chances
+// per device and inquiry of being heard and of being renamed, and
+// randomAddrRate is the share of devices that show a new address at
+// every inquiry. inquiryMs of 0 keeps the requested inquiry length.
+struct SimConfig {
+    int deviceCnt;
+    uint64_t seed;
+    int inquiryMs;
+    int connMs;
+    int nameMs;
+    int verMs;
+    double spread;
+    double visibleRate;
+    double pageFailRate;
+    double nameFailRate;
+    double verFailRate;
+    double churnRate;
+    double randomAddrRate;
+};
+
+struct SimDevice {
+    bdaddr_t addr;
+    uint8_t kind;
+    uint8_t devClass[3];
+    uint8_t lmpVer;
+    uint16_t lmpSubVer;
+    uint16_t manufacturer;
+    int8_t rssi;
+    uint16_t clockOffset;
+    bool isRandomAddr;
+    uint16_t nameRev;
+    char name[40];
+};
+
+struct SimLink {
+    uint16_t handle;
+    int devIdx;
+};
+
+struct SimEvent {
+    int64_t at;
+    uint64_t seq;
+    int len;
+    unsigned char buf[1 + HCI_EVENT_HDR_SIZE + HCI_MAX_EVENT_SIZE];
+};
+
+struct SimState {
+    struct SimConfig config;
+    uint64_t rand;
+    int timerFd;
+    uint8_t inquiryMode;
+    struct SimDevice *devices;
+    struct BTIndex index;
+    struct SimLink links[64];
+    int linkCnt;
+    uint16_t nextHandle;
+    // Min-heap of pending events by time, then by send order.
+    struct SimEvent **events;
+    int eventCnt;
+    int eventCap;
+    uint64_t eventSeq;
+};
+
+void SimDefaults(struct SimConfig *config);
+bool SimParse(struct SimConfig *config, const char *spec);
+struct HCISession *SimSessionOpen(const struct SimConfig *config);
@@ -4,179 +4,728 @@
  * https://www.linkedin.com/in/hermawan-ho-a3801194/
  * GNU General Public License (GPL) v3.0
  */
+#include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
 #include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <time.h>
 #include <bluetooth/bluetooth.h>
 #include <bluetooth/hci.h>
 #include "btinfo.h"
+#include "btcache.h"
+#include "btcompany.h"
+#include "btlog.h"
+#include "btmetrics.h"
+#include "btoui.h"
+#include "bttrace.h"
+#include "hciasync.h"
+#include "hcisim.h"
+#include "btpool.h"
 #include "dbsqlite.h"
 
-const int MAX_BT_NUM = 255;
-const int LEN = 8;
+const char *DB_FILENAME = "bt.db";
+// Simulated runs keep their results apart from real ones.
+const char *SIM_DB_FILENAME = "bt-sim.db";
+// Where Debian (ieee-data) and RHEL (hwdata) install the IEEE registry.
+const char *OUI_FILENAMES[] = {
+  "/usr/share/ieee-data/oui.txt",
+  "/usr/share/hwdata/oui.txt",
+  "/usr/share/misc/oui.txt",
+  NULL
+};
 
-int getBTIdx(char addr[19], struct BTStruct *btArray, int count) {
-    for (int n2 = 0; n2 < count; n2++) {
-        if (strcmp(btArray[n2].addr, addr) == 0) {
-            return n2;
-        }
+const int PRUNE_INTERVAL = 3600;
+const int LIMIT_FACTOR = 4;
+const int MIN_CONN_LIMIT = 5000;
+const int MIN_QUERY_LIMIT = 3000;
+const int BACKOFF_BASE = 30;
+const int BACKOFF_MAX = 3600;
+
+static time_t nameTTL = 24 * 3600;
+static time_t verTTL = 0;
+static const char *dbFilename = NULL;
+static enum LogFormat logFormat = LOG_TEXT;
+
+static volatile sig_atomic_t isRunning = 1;
+static pthread_mutex_t cacheLock = PTHREAD_MUTEX_INITIALIZER;
+
+static void onSignal(int sig) {
+    isRunning = 0;
+}
+
+void saveSighting(struct PoolJob *job, uint64_t adapter, bool isAttempted) {
+    struct SightingStruct sighting;
+    sighting.seenAt = job->seenAt;
+    sighting.addr = PackAddr(&job->inquiryInfo.bdaddr);
+    sighting.adapter = adapter;
+    sighting.rssi = job->rssi;
+    sighting.clockOffset = btohs(job->inquiryInfo.clock_offset) & 0x7FFF;
+    sighting.isAttempted = isAttempted;
+    sighting.isSuccess = isAttempted && job->info.isSuccess;
+    InstSighting(&sighting);
+}
+
+// Copy the non-empty fields of bt into the cached record; returns true
+// when anything changed.
+bool mergeBT(struct BTCache *cache, int btIdx, struct BTStruct *bt) {
+    struct BTRecord *rec = &cache->recs[btIdx];
+    bool isChanged = false;
+    if(
+      (bt->name[0])
+      && (strcmp(bt->name, ArenaStr(&cache->names, rec->nameOff)) != 0)
+    ) {
+        rec->nameOff = ArenaIntern(&cache->names, bt->name);
+        isChanged = true;
+    }
+    if(
+      (bt->coName[0])
+      && (strcmp(bt->coName, ArenaStr(&cache->names, rec->coNameOff)) != 0)
+    ) {
+        rec->coNameOff = ArenaIntern(&cache->names, bt->coName);
+        isChanged = true;
+    }
+    uint16_t typeId = SymIntern(&cache->syms, bt->type);
+    if(
+      (typeId > 0)
+      && (typeId != rec->typeId)
+    ) {
+        rec->typeId = typeId;
+        isChanged = true;
+    }
+    if(
+      (bt->lmpVer > 0)
+      && (bt->lmpVer != rec->lmpVer)
+    ) {
+        rec->lmpVer = bt->lmpVer;
+        isChanged = true;
+    }
+    if(
+      (bt->lmpSubVer > 0)
+      && (bt->lmpSubVer != rec->lmpSubVer)
+    ) {
+        rec->lmpSubVer = bt->lmpSubVer;
+        isChanged = true;
+    }
+    uint16_t manufactureId = SymIntern(&cache->syms, bt->manufactureName);
+    if(
+      (manufactureId > 0)
+      && (manufactureId != rec->manufactureId)
+    ) {
+        rec->manufactureId = manufactureId;
+        isChanged = true;
+    }
+    if (bt->nameAt > rec->nameAt) {
+        rec->nameAt = bt->nameAt;
+        isChanged = true;
+    }
+    if (bt->verAt > rec->verAt) {
+        rec->verAt = bt->verAt;
+        isChanged = true;
+    }
+    if(
+      (bt->uuids[0])
+      && (strcmp(bt->uuids, ArenaStr(&cache->names, rec->uuidsOff)) != 0)
+    ) {
+        rec->uuidsOff = ArenaIntern(&cache->names, bt->uuids);
+        isChanged = true;
+    }
+    if(
+      (bt->txPower != TX_POWER_UNKNOWN)
+      && (bt->txPower != rec->txPower)
+    ) {
+        rec->txPower = bt->txPower;
+        isChanged = true;
+    }
+    return isChanged;
+}
+
+// Fill the cached record from a stored row without overwriting anything
+// the scanner already learned this run.
+void loadBT(struct BTCache *cache, struct BTStruct *bt) {
+    bdaddr_t btAddr;
+    str2ba(bt->addr, &btAddr);
+    int btIdx = CacheFind(cache, &btAddr);
+    if (btIdx < 0)
+        btIdx = CacheAdd(cache, &btAddr);
+    struct BTRecord *rec = &cache->recs[btIdx];
+    if (!rec->nameOff)
+        rec->nameOff = ArenaIntern(&cache->names, bt->name);
+    if (!rec->coNameOff)
+        rec->coNameOff = ArenaIntern(&cache->names, bt->coName);
+    if (!rec->typeId)
+        rec->typeId = SymIntern(&cache->syms, bt->type);
+    if (!rec->lmpVer)
+        rec->lmpVer = bt->lmpVer;
+    if (!rec->lmpSubVer)
+        rec->lmpSubVer = bt->lmpSubVer;
+    if (!rec->manufactureId)
+        rec->manufactureId = SymIntern(&cache->syms, bt->manufactureName);
+    if (bt->nameAt > rec->nameAt)
+        rec->nameAt = bt->nameAt;
+    if (bt->verAt > rec->verAt)
+        rec->verAt = bt->verAt;
+    if (!rec->uuidsOff)
+        rec->uuidsOff = ArenaIntern(&cache->names, bt->uuids);
+    if (rec->txPower == TX_POWER_UNKNOWN)
+        rec->txPower = bt->txPower;
+}
+
+// A device needs no connection while its name was asked for and its
+// version read within their TTLs (a TTL of 0 never expires). A device
+// that has no name counts as fresh once it was asked.
+bool isFresh(struct BTCache *cache, int btIdx, time_t now) {
+    if (btIdx < 0)
+        return false;
+    struct BTRecord *rec = &cache->recs[btIdx];
+    if(
+      (!rec->nameAt)
+      || ((nameTTL > 0) && (now - rec->nameAt >= nameTTL))
+    )
+        return false;
+    if(
+      (!rec->verAt)
+      || ((verTTL > 0) && (now - rec->verAt >= verTTL))
+    )
+        return false;
+    return true;
+}
+
+static void onLoadRow(struct BTStruct *bt, void *arg) {
+    pthread_mutex_lock(&cacheLock);
+    loadBT(arg, bt);
+    pthread_mutex_unlock(&cacheLock);
+}
+
+static void *runLoader(void *arg) {
+    struct BTCache *cache = arg;
+    TraceThread("loader");
+    GetBTs(dbFilename, onLoadRow, cache);
+    pthread_mutex_lock(&cacheLock);
+    LogPrint(
+      LOG_STATUS,
+      "Loaded %u known Bluetooth devices.\n",
+      cache->count);
+    pthread_mutex_unlock(&cacheLock);
+    return NULL;
+}
+
+static const char *getLookupTypeName(uint32_t code) {
+    uint8_t devClass[3] = {(code & 0x3f) << 2, code >> 6, 0};
+    return getTypeName(getTypeId(devClass));
+}
+
+// Assigned company ids only; the rest stay out of the table.
+static const char *getLookupManufactureName(uint32_t id) {
+    const char *name = getManufactureName(id);
+    return strcmp(name, "not assigned") != 0 ? name : NULL;
+}
+
+// Write the names of ids 0 to cnt - 1 unless the stored checksum shows
+// they are there already, as they are on every start but the first and
+// the first after the generated tables change.
+static void fillLookup(enum DBLookup lookup,
+                       uint32_t cnt,
+                       const char *(*getName)(uint32_t id)) {
+    // FNV-1a over every id and name.
+    uint64_t sum = 0xCBF29CE484222325ULL;
+    for (uint32_t id = 0; id < cnt; id++) {
+        const char *name = getName(id);
+        if (!name)
+            continue;
+        for (int n = 0; n < 4; n++)
+            sum = (sum ^ ((id >> (n * 8)) & 0xFF)) * 0x100000001B3ULL;
+        for (const char *c = name; *c; c++)
+            sum = (sum ^ (uint8_t)*c) * 0x100000001B3ULL;
+        sum = (sum ^ 0xFF) * 0x100000001B3ULL;
+    }
+    if (GetLookupSum(lookup) == (int64_t)sum)
+        return;
+    for (uint32_t id = 0; id < cnt; id++) {
+        const char *name = getName(id);
+        if (name)
+            SetLookupName(lookup, id, name);
+    }
+    SetLookupSum(lookup, sum);
+}
+
+// Name every device type and assigned company id, so the ids stored per
+// device resolve, and older databases can be migrated onto them.
+static void fillLookups() {
+    fillLookup(LOOKUP_TYPE, 32 * 64, getLookupTypeName);
+    fillLookup(LOOKUP_MANUFACTURER, 0x10000, getLookupManufactureName);
+    CommitBatch();
+}
+
+// Fill what the inquiry result itself tells about a device.
+void initBT(struct PoolJob *job, struct BTStruct *bt) {
+    memset(bt, 0, sizeof(*bt));
+    strcpy(bt->addr, job->addr);
+    const uint8_t *devClass = job->inquiryInfo.dev_class;
+    bt->cod = (devClass[2] << 16) | (devClass[1] << 8) | devClass[0];
+    bt->companyId = -1;
+    snprintf(
+      bt->type,
+      sizeof(bt->type),
+      "%s",
+      getTypeName(getTypeId(devClass)));
+    bt->txPower = TX_POWER_UNKNOWN;
+    // The vendor follows from the address alone, so fill it even when
+    // the device can't be interrogated.
+    char *coName = getCoName(&job->inquiryInfo.bdaddr);
+    if (coName) {
+        snprintf(bt->coName, sizeof(bt->coName), "%s", coName);
+        free(coName);
+    }
+}
+
+// Save what a device broadcasts in its Extended Inquiry Response. A
+// complete name counts as a fresh name; a shortened one only fills an
+// empty record.
+void saveEIR(struct PoolJob *job, struct BTCache *cache) {
+    struct EIRStruct *eir = &job->eir;
+    if(
+      (!eir->name[0])
+      && (!eir->uuids[0])
+      && (eir->txPower == TX_POWER_UNKNOWN)
+    )
+        return;
+    struct BTStruct bt;
+    initBT(job, &bt);
+    int btIdx = CacheFind(cache, &job->inquiryInfo.bdaddr);
+    if(
+      (eir->isNameComplete)
+      || ((eir->name[0]) && ((btIdx < 0) || (!cache->recs[btIdx].nameOff)))
+    ) {
+        strcpy(bt.name, eir->name);
+        if (eir->isNameComplete)
+            bt.nameAt = job->seenAt;
+    }
+    strcpy(bt.uuids, eir->uuids);
+    bt.txPower = eir->txPower;
+    if (btIdx < 0)
+        btIdx = CacheAdd(cache, &job->inquiryInfo.bdaddr);
+    if (mergeBT(cache, btIdx, &bt))
+        UpsertBT(&bt);
+}
+
+int saveBT(struct PoolJob *job, struct BTCache *cache) {
+    struct InfoStruct *info = &job->info;
+
+    // Get Device Type
+    struct BTStruct bt;
+    initBT(job, &bt);
+
+    // Save Info
+    int btIdx = CacheFind(cache, &job->inquiryInfo.bdaddr);
+    if ((btIdx > -1) && !info->isSuccess)
+        return btIdx;
+    if(info->isSuccess) {
+        strcpy(bt.name, info->name);
+        if (info->coName)
+            strcpy(bt.coName, info->coName);
+        bt.lmpVer = info->lmpVer;
+        bt.lmpSubVer = info->lmpSubVer;
+        if (bt.lmpVer > 0)
+            bt.companyId = info->manufactureId;
+        if (info->manufactureName)
+            snprintf(
+              bt.manufactureName,
+              sizeof(bt.manufactureName),
+              "%s",
+              info->manufactureName);
+        bt.nameAt = job->seenAt;
+        if (bt.lmpVer > 0)
+            bt.verAt = job->seenAt;
+    }
+    if (btIdx < 0) {
+        btIdx = CacheAdd(cache, &job->inquiryInfo.bdaddr);
+        mergeBT(cache, btIdx, &bt);
+        UpsertBT(&bt);
+    } else if (mergeBT(cache, btIdx, &bt)) {
+        UpsertBT(&bt);
+    }
+    return btIdx;
+}
+
+static uint16_t avgMs(uint16_t avg, int took) {
+    if (took <= 0)
+        return avg;
+    if (took > UINT16_MAX)
+        took = UINT16_MAX;
+    return avg ? (uint16_t)((avg * 3 + took) / 4) : (uint16_t)took;
+}
+
+static int stageLimit(uint16_t avg, int minLimit) {
+    int limit = avg * LIMIT_FACTOR;
+    return limit > minLimit ? limit : minLimit;
+}
+
+// Give devices that answered before a deadline a few times their usual
+// latency; unknown devices keep the engine defaults.
+void setLimits(struct BTRecord *rec, struct HCIStageMs *limit) {
+    memset(limit, 0, sizeof(*limit));
+    if (rec->connMs)
+        limit->conn = stageLimit(rec->connMs, MIN_CONN_LIMIT);
+    if (rec->nameMs)
+        limit->name = stageLimit(rec->nameMs, MIN_QUERY_LIMIT);
+    if (rec->verMs)
+        limit->ver = stageLimit(rec->verMs, MIN_QUERY_LIMIT);
+}
+
+// Update a device's statistics and, after a failure, back off
+// exponentially with jitter before connecting to it again.
+void recordOutcome(struct BTRecord *rec, struct PoolJob *job) {
+    if (rec->tryCnt < UINT16_MAX)
+        rec->tryCnt += 1;
+    rec->connMs = avgMs(rec->connMs, job->took.conn);
+    rec->nameMs = avgMs(rec->nameMs, job->took.name);
+    rec->verMs = avgMs(rec->verMs, job->took.ver);
+    if (job->info.isSuccess) {
+        if (rec->okCnt < UINT16_MAX)
+            rec->okCnt += 1;
+        rec->failStreak = 0;
+        rec->retryAt = 0;
+        return;
+    }
+    if (rec->failStreak < UINT8_MAX)
+        rec->failStreak += 1;
+    int delay = BACKOFF_MAX;
+    if (rec->failStreak <= 7)
+        delay = BACKOFF_BASE << (rec->failStreak - 1);
+    if (delay > BACKOFF_MAX)
+        delay = BACKOFF_MAX;
+    delay = delay / 2 + rand() % (delay / 2 + 1);
+    rec->retryAt = job->seenAt + delay;
+}
+
+// Log a device as a block of lines, or in the line format as one line of
+// key=value fields.
+void printBT(int n1,
+             struct PoolJob *job,
+             struct BTCache *cache,
+             int btIdx) {
+    if (!IsLogged(LOG_DEVICES))
+        return;
+    struct BTRecord *rec = &cache->recs[btIdx];
+    char services[200];
+    getServiceNames(
+      getServices(job->inquiryInfo.dev_class),
+      services,
+      sizeof(services));
+    char txPower[8] = "";
+    if (rec->txPower != TX_POWER_UNKNOWN)
+        snprintf(txPower, sizeof(txPower), "%d", rec->txPower);
+    struct LogMsg msg;
+    msg.len = 0;
+    if (logFormat == LOG_LINE) {
+        MsgAdd(&msg, "addr=%s", job->addr);
+        MsgAddField(&msg, "name", ArenaStr(&cache->names, rec->nameOff));
+        MsgAddField(
+          &msg,
+          "company",
+          ArenaStr(&cache->names, rec->coNameOff));
+        MsgAddField(&msg, "type", SymStr(&cache->syms, rec->typeId));
+        MsgAddField(&msg, "services", services);
+        MsgAdd(
+          &msg,
+          " lmp_ver=%d lmp_sub_ver=%d",
+          rec->lmpVer,
+          rec->lmpSubVer);
+        MsgAddField(
+          &msg,
+          "manufacturer",
+          SymStr(&cache->syms, rec->manufactureId));
+        MsgAddField(&msg, "uuids", ArenaStr(&cache->names, rec->uuidsOff));
+        MsgAddField(&msg, "tx_power", txPower);
+        MsgAdd(&msg, "\n");
+        LogPut(LOG_DEVICES, &msg);
+        return;
     }
-    return -1;
+    MsgAdd(&msg, "%d). %s\n", (n1 + 1), job->addr);
+    MsgAdd(
+      &msg,
+      "NAME             = %s\n",
+      ArenaStr(&cache->names, rec->nameOff));
+    MsgAdd(
+      &msg,
+      "COMPANY          = %s\n",
+      ArenaStr(&cache->names, rec->coNameOff));
+    MsgAdd(
+      &msg,
+      "TYPE             = %s\n",
+      SymStr(&cache->syms, rec->typeId));
+    MsgAdd(&msg, "SERVICES         = %s\n", services);
+    MsgAdd(&msg, "LMP-VER          = %d\n", rec->lmpVer);
+    MsgAdd(&msg, "LMP-SUB-VER      = %d\n", rec->lmpSubVer);
+    MsgAdd(
+      &msg,
+      "MANUFACTURE NAME = %s\n",
+      SymStr(&cache->syms, rec->manufactureId));
+    MsgAdd(
+      &msg,
+      "UUIDS            = %s\n",
+      ArenaStr(&cache->names, rec->uuidsOff));
+    MsgAdd(&msg, "TX-POWER         = %s\n", txPower);
+    LogPut(LOG_DEVICES, &msg);
 }
 
 int main(int argc, char *argv[]) {
+    int maxLinks = 0;
+    bool isStreaming = false;
+    int batchRows = 500;
+    int batchSecs = 30;
+    bool isBgLoad = false;
+    int keepDays = 30;
+    int fullHours = 24;
+    const char *ouiFilename = NULL;
+    const char *simSpec = NULL;
+    const char *metricsAddr = NULL;
+    const char *traceFilename = NULL;
+    enum LogLevel logLevel = LOG_DEVICES;
+    struct SimConfig simConfig;
+    SimDefaults(&simConfig);
+    int opt;
+    while ((opt = getopt(argc, argv, "j:sb:c:lr:d:n:v:o:S:m:t:L:F:")) != -1) {
+        switch (opt) {
+          case 'j':
+            maxLinks = atoi(optarg);
+            break;
+          case 's':
+            isStreaming = true;
+            break;
+          case 'b':
+            batchRows = atoi(optarg);
+            break;
+          case 'c':
+            batchSecs = atoi(optarg);
+            break;
+          case 'l':
+            isBgLoad = true;
+            break;
+          case 'r':
+            keepDays = atoi(optarg);
+            break;
+          case 'd':
+            fullHours = atoi(optarg);
+            break;
+          case 'n':
+            nameTTL = (time_t)atoi(optarg) * 3600;
+            break;
+          case 'v':
+            verTTL = (time_t)atoi(optarg) * 86400;
+            break;
+          case 'o':
+            ouiFilename = optarg;
+            break;
+          case 'm':
+            metricsAddr = optarg;
+            break;
+          case 't':
+            traceFilename = optarg;
+            break;
+          case 'L':
+            if (ParseLogLevel(optarg, &logLevel))
+                break;
+            printf("Invalid log level: %s\n", optarg);
+            exit(1);
+          case 'F':
+            if (ParseLogFormat(optarg, &logFormat))
+                break;
+            printf("Invalid log format: %s\n", optarg);
+            exit(1);
+          case 'S':
+            simSpec = optarg;
+            if (SimParse(&simConfig, simSpec))
+                break;
+            printf("Invalid simulation settings: %s\n", simSpec);
+            exit(1);
+          default:
+            printf(
+              "Usage: %s [-j max_links] [-s] [-b batch_rows]"
+              " [-c batch_secs] [-l] [-r keep_days] [-d full_hours]"
+              " [-n name_ttl_hours] [-v version_ttl_days] [-o oui_file]"
+              " [-S simulation] [-m metrics_port_or_socket]"
+              " [-t trace_file] [-L quiet|status|devices] [-F text|line]\n",
+              argv[0]);
+            exit(1);
+        }
+    }
+
+    srand(time(NULL) ^ getpid());
+    if (!LogOpen(logLevel, stdout)) {
+        perror("Can't create log thread");
+        exit(1);
+    }
+
+    struct sigaction sigAction;
+    memset(&sigAction, 0, sizeof(sigAction));
+    sigAction.sa_handler = onSignal;
+    sigaction(SIGINT, &sigAction, NULL);
+    sigaction(SIGTERM, &sigAction, NULL);
+
+    if (ouiFilename) {
+        if (!OpenOUI(ouiFilename)) {
+            perror("Can't load OUI registry");
+            exit(1);
+        }
+    } else {
+        int n = 0;
+        for (; OUI_FILENAMES[n]; n++) {
+            if (OpenOUI(OUI_FILENAMES[n]))
+                break;
+            CloseOUI();
+        }
+        if (!OUI_FILENAMES[n])
+            LogPrint(
+              LOG_STATUS,
+              "No OUI registry found; company names stay empty.\n");
+    }
+
+    dbFilename = simSpec ? SIM_DB_FILENAME : DB_FILENAME;
+    if (metricsAddr && !MetricsServe(metricsAddr)) {
+        perror("Can't serve metrics");
+        exit(1);
+    }
+    if (traceFilename && !TraceOpen(traceFilename)) {
+        perror("Can't open trace file");
+        exit(1);
+    }
+    TraceThread("main");
+
+    OpenDB(dbFilename);
+    SetBatchLimits(batchRows, batchSecs * 1000);
+    CreateTblLookups();
+    fillLookups();
     CreateTblBT();
-    int count = GetBTsCnt();
-    struct BTStruct *btArray = malloc(count * sizeof(struct BTStruct));
-    GetBTs(btArray);
-    while(1) {
-        printf("START SCANNING\n");
+    CreateTblSightings();
+    struct BTCache cache;
+    CacheInit(&cache, 0);
+    pthread_t loader;
+    if (isBgLoad) {
+        if (pthread_create(&loader, NULL, runLoader, &cache) != 0) {
+            perror("Can't create loader thread");
+            exit(1);
+        }
+    } else {
+        GetBTs(NULL, onLoadRow, &cache);
+        LogPrint(
+          LOG_STATUS,
+          "Loaded %u known Bluetooth devices.\n",
+          cache.count);
+    }
+
+    struct HCISession *session;
+    if (simSpec) {
+        session = SimSessionOpen(&simConfig);
+        LogPrint(
+          LOG_STATUS,
+          "Simulating %d Bluetooth devices.\n",
+          simConfig.deviceCnt);
+    } else {
         int devId = hci_get_route(NULL);
-        int socket = hci_open_dev( devId );
-        if ( (devId < 0) || (socket < 0) ) {
+        if (devId < 0) {
             perror("opening socket");
             exit(1);
         }
-        inquiry_info *inquiryInfo = (inquiry_info*)malloc(
-          MAX_BT_NUM * sizeof(inquiry_info)
-        );
-        int btNum = hci_inquiry(
-          devId,
-          LEN, MAX_BT_NUM,
-          NULL,
-          &inquiryInfo,
-          IREQ_CACHE_FLUSH);
-        if( btNum < 0 )
-            perror("hci_inquiry");
-        printf("Found %d Bluetooth devices.\n", btNum);
-        char addr[19] = {0};
-        for (int n1 = 0; n1 < btNum; n1++) {
-            struct BTStruct bt;
-            inquiry_info *currentInquiryInfo = inquiryInfo + n1;
-            ba2str(&(currentInquiryInfo)->bdaddr, addr);
-            printf("%d). %s\n", (n1 + 1), addr);
-
-            // Get Device Type
-            char type[50];
-            getType(currentInquiryInfo, type);
-
-            // Get Device Info
-            struct InfoStruct info =  getHCIInfo(devId, addr);
-
-            // Save Info
-            int btIdx = getBTIdx(addr, btArray, count);
-
-            if(btIdx > -1) {
-                if (!info.isSuccess) {
-                    continue;
-                }
-                char updName[249] = "";
-                if(
-                  (info.name)
-                  && (strcmp(updName, btArray[btIdx].name) != 0)
-                ) {
-                    strcpy(updName, info.name);
-                    strcpy(btArray[btIdx].name, info.name);
-                }
-                char updCoName[255] = "";
-                if(
-                  (info.coName)
-                  && (strcmp(info.coName, btArray[btIdx].coName) != 0)
-                ) {
-                    strcpy(updCoName, info.coName);
-                    strcpy(btArray[btIdx].coName, info.coName);
-                }
-                char updType[50] = "";
-                if(
-                  (type)
-                  && (strcmp(type, btArray[btIdx].type) != 0)
-                ) {
-                    strcpy(updType, type);
-                    strcpy(btArray[btIdx].type, type);
-                }
-                uint8_t updLmpVer;
-                if(
-                  (info.lmpVer > 0)
-                  && (info.lmpVer != btArray[btIdx].lmpVer) 
-                ) {
-                    updLmpVer = info.lmpVer;
-                    btArray[btIdx].lmpVer = info.lmpVer;
-                } else {
-                    updLmpVer = 0;
-                }
-                uint16_t updLmpSubVer;
-                if(
-                  (info.lmpSubVer > 0)
-                  && (info.lmpSubVer != btArray[btIdx].lmpSubVer) 
-                ) {
-                    updLmpSubVer = info.lmpSubVer;
-                    btArray[btIdx].lmpSubVer = info.lmpSubVer;
-                } else {
-                    updLmpSubVer = 0;
-                }
-                char updManufactureName[49] = "";
-                if(
-                  (info.manufactureName)
-                  && (strcmp(
-                        info.manufactureName,
-                        btArray[btIdx].manufactureName) != 0)
-                ) {
-                    strcpy(updManufactureName, info.manufactureName);
-                    strcpy(
-                      btArray[btIdx].manufactureName,
-                      info.manufactureName);
-                }
-                UpdBT(
-                  addr,
-                  updName,
-                  updCoName,
-                  updType,
-                  updLmpVer,
-                  updLmpSubVer,
-                  updManufactureName);
-                bt = btArray[btIdx];
-            } else {
-                strcpy(bt.addr, info.addr);
-                strcpy(bt.type, type);
-                if(info.isSuccess) {
-                    if (info.name)
-                        strcpy(bt.name, info.name);
-                    if (info.coName)
-                        strcpy(bt.coName, info.coName);
-                    bt.lmpVer = info.lmpVer;
-                    bt.lmpSubVer = info.lmpSubVer;
-                    if (info.manufactureName)
-                        strcpy(bt.manufactureName, info.manufactureName);
-                } else {
-                    strcpy(bt.name, "");
-                    strcpy(bt.coName, "");
-                    bt.lmpVer = 0;
-                    bt.lmpSubVer = 0;
-                    strcpy(bt.manufactureName, "");
-                }
-                InstBT(bt);
-
-                count += 1;
-                struct BTStruct *newBTArray = realloc(
-                  btArray,
-                  count * sizeof(struct BTStruct)
-                );
-                if (newBTArray == NULL) {
-                    printf("Memory reallocation failed.\n");
-                    free(btArray);
-                    exit(1);
-                }
-                btArray = newBTArray;
-                newBTArray = NULL;
-                btArray[count - 1] = bt;
+        session = SessionOpen(devId);
+    }
+    uint64_t adapter = PackAddr(&session->devInfo.bdaddr);
+    if (maxLinks <= 0)
+        maxLinks = MAX_ACL_LINKS;
+    LogPrint(
+      LOG_STATUS,
+      "Interrogating up to %d Bluetooth devices at once.\n",
+      maxLinks);
+    struct BTPool *pool = PoolOpen(session, maxLinks, isStreaming);
+
+    LogPrint(LOG_STATUS, "START SCANNING\n");
+    int n1 = 0;
+    time_t prunedAt = 0;
+    uint64_t cycleAt = MetricNow();
+    while(isRunning) {
+        struct PoolJob *job = PoolNext(pool);
+        if (!job)
+            continue;
+        uint64_t jobAt = MetricNow();
+        if (job->evt == POOL_FOUND) {
+            pthread_mutex_lock(&cacheLock);
+            saveEIR(job, &cache);
+            if (PoolIsPending(pool, &job->inquiryInfo.bdaddr)) {
+                pthread_mutex_unlock(&cacheLock);
+                saveSighting(job, adapter, false);
+                free(job);
+                TraceSince("found", jobAt);
+                continue;
+            }
+            int btIdx = CacheFind(&cache, &job->inquiryInfo.bdaddr);
+            if(
+              (btIdx < 0)
+              || (
+                !isFresh(&cache, btIdx, job->seenAt)
+                && (cache.recs[btIdx].retryAt <= job->seenAt)
+              )
+            ) {
+                if (btIdx > -1)
+                    setLimits(&cache.recs[btIdx], &job->limit);
+                pthread_mutex_unlock(&cacheLock);
+                PoolSubmit(pool, job);
+                TraceSince("found", jobAt);
+                continue;
+            }
+            printBT(n1, job, &cache, btIdx);
+            pthread_mutex_unlock(&cacheLock);
+            MetricAdd(COUNT_SKIPPED, 1);
+            saveSighting(job, adapter, false);
+            free(job);
+            n1 += 1;
+            TraceSince("found", jobAt);
+            continue;
+        }
+        if (job->evt == POOL_CYCLE_END) {
+            if (time(NULL) - prunedAt >= PRUNE_INTERVAL) {
+                PruneSightings(keepDays, fullHours);
+                prunedAt = time(NULL);
             }
-            printf("NAME             = %s\n", bt.name);
-            printf("COMPANY          = %s\n", bt.coName);
-            printf("TYPE             = %s\n", bt.type);
-            printf("LMP-VER          = %d\n", bt.lmpVer);
-            printf("LMP-SUB-VER      = %d\n", bt.lmpSubVer);
-            printf("MANUFACTURE NAME = %s\n", bt.manufactureName);
+            CommitBatch();
+            MetricSince(HIST_CYCLE, cycleAt);
+            TraceTrack("cycle", "cycle", 0, cycleAt, MetricNow());
+            MetricAdd(COUNT_CYCLES, 1);
+            MetricSet(GAUGE_CYCLE_FOUND, job->foundCnt);
+            pthread_mutex_lock(&cacheLock);
+            MetricSet(GAUGE_KNOWN_DEVICES, cache.count);
+            pthread_mutex_unlock(&cacheLock);
+            cycleAt = MetricNow();
+            LogPrint(
+              LOG_STATUS,
+              "Found %d Bluetooth devices.\nSTART SCANNING\n",
+              job->foundCnt);
+            free(job);
+            n1 = 0;
+            continue;
         }
-        free(inquiryInfo);
-        close(socket);
+        saveSighting(job, adapter, true);
+        pthread_mutex_lock(&cacheLock);
+        int btIdx = saveBT(job, &cache);
+        recordOutcome(&cache.recs[btIdx], job);
+        printBT(n1, job, &cache, btIdx);
+        pthread_mutex_unlock(&cacheLock);
+        free(job->info.coName);
+        free(job);
+        n1 += 1;
+        TraceSince("done", jobAt);
     }
+    PoolClose(pool);
+    SessionClose(session);
+    if (isBgLoad)
+        pthread_join(loader, NULL);
+    CacheFree(&cache);
+    CloseDB();
+    CloseOUI();
+    TraceClose();
+    MetricsClose();
+    LogClose();
+    return 0;
 }